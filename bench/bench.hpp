@@ -0,0 +1,42 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+namespace bench {
+
+// Keeps the optimizer from discarding a result the benchmark never reads.
+template <typename T>
+inline void keep(const T& value) {
+#if defined(_MSC_VER)
+    static const void* volatile sink;
+    sink = &value;
+#else
+    asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+// Iteration count from argv[1], so CI can run a short pass.
+inline std::uint64_t iterations(int argc, char** argv, std::uint64_t fallback) {
+    return argc > 1 ? std::strtoull(argv[1], nullptr, 10) : fallback;
+}
+
+// Runs fn `iters` times after a short warm-up and prints ns per call, plus
+// throughput when `bytes` (per call) is given. Returns ns per call.
+template <typename Fn>
+double run(const char* name, std::uint64_t iters, Fn&& fn, std::uint64_t bytes = 0) {
+    for (std::uint64_t i = 0; i < iters / 10 + 1; ++i) fn();
+    auto start = std::chrono::steady_clock::now();
+    for (std::uint64_t i = 0; i < iters; ++i) fn();
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    double per = iters ? ns / static_cast<double>(iters) : 0.0;
+    if (bytes) {
+        std::printf("  %-40s %10.1f ns/op %9.1f MB/s\n", name, per, per > 0 ? bytes * 1000.0 / per : 0.0);
+    } else {
+        std::printf("  %-40s %10.1f ns/op\n", name, per);
+    }
+    return per;
+}
+
+}
@@ -0,0 +1,31 @@
+#include "bench.hpp"
+#include "http.hpp"
+#include "http_parser.hpp"
+#include "samples.hpp"
+
+// Request-head parsing over header sets captured from common clients.
+// Compares the resumable RequestParser (alone, and with the conversion the
+// thread backend does) against the original istringstream parse_request.
+
+int main(int argc, char** argv) {
+    std::uint64_t iters = bench::iterations(argc, argv, 200000);
+    for (const auto& s : bench::kSamples) {
+        std::printf("%s (%zu bytes)\n", s.name, s.text.size());
+        bench::run("RequestParser::parse", iters, [&] {
+            web::RequestParser p;
+            bench::keep(p.parse(s.text));
+            bench::keep(p.request().header_count);
+        }, s.text.size());
+        bench::run("RequestParser::parse + to_request", iters, [&] {
+            web::RequestParser p;
+            p.parse(s.text);
+            web::Request r = web::to_request(p.request());
+            bench::keep(r.headers.size());
+        }, s.text.size());
+        bench::run("parse_request (baseline)", iters, [&] {
+            web::Request r = web::parse_request(s.text);
+            bench::keep(r.headers.size());
+        }, s.text.size());
+    }
+    return 0;
+}
@@ -0,0 +1,163 @@
+#include "bench.hpp"
+#include "router.hpp"
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Route lookup over ~300 REST-style patterns with :param segments and
+// *wildcard tails. Router::match_streaming walks the per-method radix tree;
+// the baseline tries each pattern in turn, segment by segment, which is
+// what the old exact-match map would have needed to support parameters.
+// The old map itself (a "METHOD path" key per lookup) is timed on the
+// static routes, the only ones it could serve.
+
+namespace {
+
+const char* const kResources[] = {
+    "users", "orders", "invoices", "products", "carts", "payments", "shipments", "reviews",
+    "categories", "coupons", "addresses", "teams", "projects", "tasks", "comments", "labels",
+    "milestones", "releases", "builds", "deployments", "alerts", "metrics", "logs", "tokens",
+    "webhooks", "sessions", "devices", "messages", "threads", "reports",
+};
+
+struct Pattern {
+    const char* method;
+    const char* shape;
+};
+
+// "R" is replaced with the resource name.
+const Pattern kShapes[] = {
+    {"GET", "/api/v1/R"},
+    {"POST", "/api/v1/R"},
+    {"GET", "/api/v1/R/:id"},
+    {"PUT", "/api/v1/R/:id"},
+    {"DELETE", "/api/v1/R/:id"},
+    {"GET", "/api/v1/R/:id/history"},
+    {"GET", "/api/v1/R/:id/comments/:cid"},
+    {"POST", "/api/v1/R/:id/comments"},
+    {"GET", "/files/R/*path"},
+    {"GET", "/R/:slug"},
+};
+
+std::string expand(const char* shape, const std::string& res) {
+    std::string s = shape;
+    auto at = s.find('R');
+    return s.replace(at, 1, res);
+}
+
+struct LinearRoute {
+    std::string method;
+    std::vector<std::string> segs;
+    unsigned id;
+};
+
+std::vector<std::string> split(std::string_view p) {
+    std::vector<std::string> out;
+    std::size_t i = 1;
+    while (i <= p.size()) {
+        std::size_t e = p.find('/', i);
+        if (e == std::string_view::npos) e = p.size();
+        out.emplace_back(p.substr(i, e - i));
+        i = e + 1;
+    }
+    return out;
+}
+
+bool match_segments(const LinearRoute& r, std::string_view path, web::RouteParams& params) {
+    params.count = 0;
+    std::size_t pos = 1;
+    for (const auto& seg : r.segs) {
+        if (pos > path.size()) return false;
+        if (seg[0] == '*') {
+            params.items[params.count++] = {std::string_view(seg).substr(1), static_cast<std::uint32_t>(pos), static_cast<std::uint32_t>(path.size() - pos)};
+            return true;
+        }
+        std::size_t end = path.find('/', pos);
+        if (end == std::string_view::npos) end = path.size();
+        std::string_view piece = path.substr(pos, end - pos);
+        if (seg[0] == ':') {
+            if (piece.empty() || params.count == web::RouteParams::kMax) return false;
+            params.items[params.count++] = {std::string_view(seg).substr(1), static_cast<std::uint32_t>(pos), static_cast<std::uint32_t>(piece.size())};
+        } else if (piece != seg) {
+            return false;
+        }
+        pos = end + 1;
+    }
+    return pos == path.size() + 1;
+}
+
+int linear_match(const std::vector<LinearRoute>& routes, std::string_view method, std::string_view path, web::RouteParams& params) {
+    for (const auto& r : routes) {
+        if (r.method == method && match_segments(r, path, params)) return static_cast<int>(r.id);
+    }
+    return -1;
+}
+
+}
+
+int main(int argc, char** argv) {
+    std::uint64_t iters = bench::iterations(argc, argv, 200000);
+
+    web::Router router;
+    std::vector<LinearRoute> linear;
+    std::unordered_map<std::string, unsigned> old_map;
+    unsigned next_id = web::Router::kUnmatchedRoute + 1;
+    for (const char* res : kResources) {
+        for (const auto& p : kShapes) {
+            std::string path = expand(p.shape, res);
+            router.add_streaming(p.method, path, [](const web::Request&) { return std::unique_ptr<web::BodyReader>(); });
+            linear.push_back({p.method, split(path), next_id});
+            if (path.find_first_of(":*") == std::string::npos) old_map.emplace(std::string(p.method) + " " + path, next_id);
+            ++next_id;
+        }
+    }
+
+    struct Query {
+        const char* label;
+        std::string method;
+        std::string path;
+    };
+    std::vector<Query> queries = {
+        {"static, early", "GET", "/api/v1/users"},
+        {"static, late", "POST", "/api/v1/reports"},
+        {"one param", "GET", "/api/v1/shipments/84213"},
+        {"two params", "GET", "/api/v1/webhooks/77/comments/1203"},
+        {"wildcard", "GET", "/files/releases/2024/06/notes/changelog.txt"},
+        {"top-level param", "GET", "/threads/how-to-tune-epoll"},
+        {"miss", "GET", "/api/v2/users/1"},
+    };
+
+    std::printf("%zu routes\n", linear.size());
+    for (const auto& q : queries) {
+        web::Request r;
+        r.method = q.method;
+        r.path = q.path;
+        unsigned tree_id = web::Router::kUnmatchedRoute;
+        bool tree_hit = router.match_streaming(r, tree_id) != nullptr;
+        web::RouteParams lp;
+        int lin = linear_match(linear, q.method, q.path, lp);
+        if (tree_hit != (lin >= 0) || (tree_hit && (tree_id != static_cast<unsigned>(lin) || r.params.count != lp.count))) {
+            std::fprintf(stderr, "%s: radix tree and linear router disagree\n", q.path.c_str());
+            return 1;
+        }
+
+        std::printf("%s: %s %s\n", q.label, q.method.c_str(), q.path.c_str());
+        bench::run("Router::match_streaming", iters, [&] {
+            unsigned id = 0;
+            bench::keep(router.match_streaming(r, id));
+            bench::keep(id);
+        });
+        bench::run("linear segment match (baseline)", iters, [&] {
+            web::RouteParams p;
+            bench::keep(linear_match(linear, q.method, q.path, p));
+        });
+        if (old_map.count(q.method + " " + q.path)) {
+            bench::run("old map lookup (static only)", iters, [&] {
+                auto it = old_map.find(q.method + " " + q.path);
+                bench::keep(it == old_map.end() ? 0u : it->second);
+            });
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include "bench.hpp"
+#include "samples.hpp"
+#include "scan.hpp"
+#include <string_view>
+#include <vector>
+
+// Dispatched byte scanners against the plain loops they replaced, over the
+// fields of real request heads: method and header names (scan_token), the
+// request target (scan_target) and header values (scan_value).
+
+namespace {
+
+struct Field {
+    std::size_t from;
+    std::size_t to;
+};
+
+struct Fields {
+    std::vector<Field> tokens, targets, values;
+};
+
+std::size_t token_loop(const char* d, std::size_t i, std::size_t n) {
+    while (i < n && web::is_token_char(static_cast<unsigned char>(d[i]))) ++i;
+    return i;
+}
+
+std::size_t target_loop(const char* d, std::size_t i, std::size_t n) {
+    while (i < n && static_cast<unsigned char>(d[i]) > 0x20 && d[i] != 0x7f) ++i;
+    return i;
+}
+
+std::size_t value_loop(const char* d, std::size_t i, std::size_t n) {
+    while (i < n) {
+        unsigned char c = static_cast<unsigned char>(d[i]);
+        if ((c < 0x20 && c != '\t') || c == 0x7f) break;
+        ++i;
+    }
+    return i;
+}
+
+Fields split_fields(std::string_view head) {
+    Fields f;
+    std::size_t sp = head.find(' ');
+    f.tokens.push_back({0, sp});
+    std::size_t sp2 = head.find(' ', sp + 1);
+    f.targets.push_back({sp + 1, sp2});
+    std::size_t line = head.find("\r\n") + 2;
+    while (line < head.size() && head[line] != '\r') {
+        std::size_t colon = head.find(':', line);
+        std::size_t eol = head.find("\r\n", line);
+        f.tokens.push_back({line, colon});
+        f.values.push_back({colon + 2, eol});
+        line = eol + 2;
+    }
+    return f;
+}
+
+// The scanners read up to the buffer end, so each field is scanned with
+// the rest of the head behind it, as the parser does.
+template <typename Scan>
+std::size_t scan_all(const std::string& text, const std::vector<Field>& fields, Scan scan) {
+    std::size_t sum = 0;
+    for (const Field& f : fields) sum += scan(text.data(), f.from, text.size());
+    return sum;
+}
+
+bool verify_token_scanner() {
+    std::string buf(96, 'a');
+    for (int c = 0; c < 256; ++c) {
+        for (std::size_t at = 0; at < 64; ++at) {
+            buf.assign(96, 'a');
+            buf[at] = static_cast<char>(c);
+            std::size_t want = web::is_token_char(static_cast<unsigned char>(c)) ? buf.size() : at;
+            for (std::size_t from = 0; from <= at; from += 7) {
+                if (web::scan_token(buf.data(), from, buf.size()) != want) {
+                    std::fprintf(stderr, "scan_token mismatch: byte 0x%02x at %zu from %zu\n", c, at, from);
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+}
+
+int main(int argc, char** argv) {
+    std::uint64_t iters = bench::iterations(argc, argv, 500000);
+    if (!verify_token_scanner()) return 1;
+    std::printf("scanner implementation: %s\n", web::scan_impl_name());
+    for (const auto& s : bench::kSamples) {
+        Fields f = split_fields(s.text);
+        if (scan_all(s.text, f.tokens, web::scan_token) != scan_all(s.text, f.tokens, token_loop) ||
+            scan_all(s.text, f.targets, web::scan_target) != scan_all(s.text, f.targets, target_loop) ||
+            scan_all(s.text, f.values, web::scan_value) != scan_all(s.text, f.values, value_loop)) {
+            std::fprintf(stderr, "%s: dispatched scanner disagrees with the scalar loop\n", s.name);
+            return 1;
+        }
+        std::size_t token_bytes = 0, value_bytes = 0;
+        for (const Field& x : f.tokens) token_bytes += x.to - x.from;
+        for (const Field& x : f.values) value_bytes += x.to - x.from;
+        std::printf("%s (%zu names, %zu values)\n", s.name, f.tokens.size(), f.values.size());
+        bench::run("names: scalar loop", iters, [&] { bench::keep(scan_all(s.text, f.tokens, token_loop)); }, token_bytes);
+        bench::run("names: scan_token", iters, [&] { bench::keep(scan_all(s.text, f.tokens, web::scan_token)); }, token_bytes);
+        bench::run("values: scalar loop", iters, [&] { bench::keep(scan_all(s.text, f.values, value_loop)); }, value_bytes);
+        bench::run("values: scan_value", iters, [&] { bench::keep(scan_all(s.text, f.values, web::scan_value)); }, value_bytes);
+        bench::run("target: scalar loop", iters, [&] { bench::keep(scan_all(s.text, f.targets, target_loop)); });
+        bench::run("target: scan_target", iters, [&] { bench::keep(scan_all(s.text, f.targets, web::scan_target)); });
+    }
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include "bench.hpp"
+#include "template.hpp"
+#include <sstream>
+#include <string>
+
+// Renders a portfolio-style page with a large {% for %} list through the
+// compiled template paths and through the original string-rewriting
+// renderer, kept below as the baseline.
+
+namespace {
+
+namespace legacy {
+
+// TemplateEngine::render as it was before templates were compiled: each
+// variable is a find/replace pass over the whole text, and each list row
+// re-runs those passes over the block body.
+std::string replace_all(std::string s, const std::string& from, const std::string& to) {
+    size_t pos = 0;
+    while ((pos = s.find(from, pos)) != std::string::npos) {
+        s.replace(pos, from.size(), to);
+        pos += to.size();
+    }
+    return s;
+}
+
+std::string interp(const std::string& s, const web::Vars& vars) {
+    std::string out = s;
+    for (auto& [k, v] : vars) {
+        out = replace_all(out, "{{" + k + "}}", v);
+    }
+    return out;
+}
+
+bool find_block(const std::string& tpl, const std::string& name, size_t& begin, size_t& end) {
+    auto start_tag = std::string("{% for ") + name + " %}";
+    auto end_tag = std::string("{% endfor %}");
+    begin = tpl.find(start_tag);
+    if (begin == std::string::npos) return false;
+    auto body_start = begin + start_tag.size();
+    end = tpl.find(end_tag, body_start);
+    if (end == std::string::npos) return false;
+    return true;
+}
+
+std::string render(const std::string& tpl, const web::Vars& vars, const web::Lists& lists) {
+    std::string out = interp(tpl, vars);
+    for (auto& [list_name, rows] : lists) {
+        size_t b{}, e{};
+        if (find_block(out, list_name, b, e)) {
+            auto start_tag = std::string("{% for ") + list_name + " %}";
+            auto body_start = b + start_tag.size();
+            auto body = out.substr(body_start, e - body_start);
+            std::ostringstream built;
+            for (auto& row : rows) {
+                built << interp(body, row);
+            }
+            out = out.substr(0, b) + built.str() + out.substr(e + std::string("{% endfor %}").size());
+        }
+    }
+    return out;
+}
+
+}
+
+const char* const kPage = R"(<!DOCTYPE html>
+<html>
+<head>
+  <meta charset="utf-8"/>
+  <title>{{title}}</title>
+  <link rel="stylesheet" href="/assets/main.css">
+</head>
+<body>
+  <h1>{{heading}}</h1>
+  <p class="muted">{{subtitle}}</p>
+  <ul>
+    {% for projects %}
+      <li>
+        <strong>{{name}}</strong>
+        <span class="muted"> - {{tags}}</span>
+        <div>{{desc}}</div>
+        <a class="btn" href="/portfolio/{{id}}">View</a>
+        <a href="{{link}}">Source</a>
+      </li>
+    {% endfor %}
+  </ul>
+  <p><a href="/">Back</a> - {{footer}}</p>
+</body>
+</html>
+)";
+
+}
+
+int main(int argc, char** argv) {
+    std::uint64_t iters = bench::iterations(argc, argv, 200);
+    std::size_t rows = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2000;
+
+    const std::string tpl = kPage;
+    web::Vars vars{{"title", "Portfolio"}, {"heading", "Selected projects"}, {"subtitle", "Things built over the years"}, {"footer", "Updated weekly"}};
+    web::Lists lists;
+    auto& projects = lists["projects"];
+    for (std::size_t i = 0; i < rows; ++i) {
+        std::string n = std::to_string(i);
+        projects.push_back({
+            {"name", "Project " + n},
+            {"tags", "c++, networking, http"},
+            {"desc", "A small service that does one thing well, number " + n + "."},
+            {"id", n},
+            {"link", "https://git.example.com/projects/" + n},
+        });
+    }
+
+    auto compiled = web::CompiledTemplate::compile(tpl);
+    web::TemplateEngine engine;
+    std::string expect = legacy::render(tpl, vars, lists);
+    if (compiled->render(vars, lists) != expect || engine.render(tpl, vars, lists) != expect) {
+        std::fprintf(stderr, "compiled output differs from the baseline renderer\n");
+        return 1;
+    }
+
+    std::printf("%zu rows, %zu bytes out\n", rows, expect.size());
+    bench::run("legacy render (baseline)", iters, [&] {
+        bench::keep(legacy::render(tpl, vars, lists).size());
+    }, expect.size());
+    bench::run("TemplateEngine::render", iters, [&] {
+        bench::keep(engine.render(tpl, vars, lists).size());
+    }, expect.size());
+    bench::run("CompiledTemplate::render", iters, [&] {
+        bench::keep(compiled->render(vars, lists).size());
+    }, expect.size());
+    std::string out;
+    bench::run("CompiledTemplate::render_into (reused)", iters, [&] {
+        out.clear();
+        compiled->render_into(out, vars, lists);
+        bench::keep(out.size());
+    }, expect.size());
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include "bench.hpp"
+#include "work_queue.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Stress test and throughput benchmark for StealingQueues. For each worker
+// count from 2 to 64, producers push unique ids into a deliberately small
+// queue while workers pop, steal and park exactly as Server::worker_loop
+// does. Every id must be popped exactly once. A lost wakeup in the
+// park/notify handshake would strand items with every worker asleep, so a
+// run that stops making progress fails instead of hanging.
+
+namespace {
+
+constexpr std::size_t kCapacity = 64;
+constexpr auto kStallLimit = std::chrono::seconds(10);
+
+struct Run {
+    bool ok;
+    double seconds;
+};
+
+Run run(unsigned workers, unsigned producers, std::uint64_t items) {
+    web::StealingQueues<std::uint64_t> q(workers, kCapacity);
+    std::vector<std::atomic<std::uint8_t>> seen(items);
+    std::atomic<std::uint64_t> consumed{0};
+    std::atomic<bool> running{true};
+    std::atomic<bool> out_of_range{false};
+
+    auto start = std::chrono::steady_clock::now();
+    auto end = start;
+    std::vector<std::thread> threads;
+    for (unsigned w = 0; w < workers; ++w) {
+        threads.emplace_back([&, w] {
+            std::uint64_t id;
+            while (running.load(std::memory_order_relaxed)) {
+                if (!q.pop(w, id)) {
+                    q.park(w, running);
+                    continue;
+                }
+                if (id >= items) out_of_range = true;
+                else seen[id].fetch_add(1, std::memory_order_relaxed);
+                if (consumed.fetch_add(1, std::memory_order_relaxed) + 1 == items) end = std::chrono::steady_clock::now();
+            }
+        });
+    }
+    for (unsigned p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p] {
+            for (std::uint64_t id = p; id < items; id += producers) {
+                std::uint64_t v = id;
+                while (!q.push(std::move(v))) std::this_thread::yield();
+            }
+        });
+    }
+
+    // Watchdog: progress is checked every 100 ms.
+    std::uint64_t last = 0;
+    auto last_change = std::chrono::steady_clock::now();
+    bool stalled = false;
+    while (consumed.load() < items) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        std::uint64_t now = consumed.load();
+        if (now != last) {
+            last = now;
+            last_change = std::chrono::steady_clock::now();
+        } else if (std::chrono::steady_clock::now() - last_change > kStallLimit) {
+            stalled = true;
+            break;
+        }
+    }
+    if (stalled) {
+        std::fprintf(stderr, "%u workers: stalled with %llu of %llu items consumed, %zu still queued\n", workers,
+            static_cast<unsigned long long>(consumed.load()), static_cast<unsigned long long>(items), q.size());
+        // Parked workers would never be joined; leave without unwinding.
+        std::fflush(stderr);
+        std::_Exit(1);
+    }
+    running = false;
+    q.wake_all();
+    for (auto& t : threads) t.join();
+    double secs = std::chrono::duration<double>(end - start).count();
+
+    bool ok = !out_of_range && consumed.load() == items && q.size() == 0;
+    std::uint64_t lost = 0, dup = 0;
+    for (auto& s : seen) {
+        auto c = s.load(std::memory_order_relaxed);
+        if (c == 0) ++lost;
+        if (c > 1) ++dup;
+    }
+    if (!ok || lost || dup) {
+        std::fprintf(stderr, "%u workers: %llu lost, %llu duplicated, %llu consumed of %llu\n", workers,
+            static_cast<unsigned long long>(lost), static_cast<unsigned long long>(dup),
+            static_cast<unsigned long long>(consumed.load()), static_cast<unsigned long long>(items));
+        return {false, secs};
+    }
+    return {true, secs};
+}
+
+}
+
+int main(int argc, char** argv) {
+    std::uint64_t items = bench::iterations(argc, argv, 2000000);
+    unsigned rounds = argc > 2 ? static_cast<unsigned>(std::strtoul(argv[2], nullptr, 10)) : 1;
+    std::printf("%llu items per run, queue capacity %zu\n", static_cast<unsigned long long>(items), kCapacity);
+    for (unsigned workers = 2; workers <= 64; workers *= 2) {
+        unsigned producers = workers / 4 ? workers / 4 : 1;
+        for (unsigned r = 0; r < rounds; ++r) {
+            Run res = run(workers, producers, items);
+            if (!res.ok) return 1;
+            std::printf("  %2u workers, %2u producers %10.0f items/s\n", workers, producers, items / res.seconds);
+        }
+    }
+    return 0;
+}
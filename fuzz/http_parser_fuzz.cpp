@@ -0,0 +1,195 @@
+#include "http_parser.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Differential fuzz driver for RequestParser. Every input is parsed once in
+// a single call and again fed in random byte splits (sometimes one byte at a
+// time) through a growing buffer. The two must agree on the status, and for
+// a complete head on every field of the view. Runs standalone with a seed
+// and iteration count; built with -fsanitize=fuzzer and WEB_LIBFUZZER it
+// exposes the same check to libFuzzer.
+
+namespace {
+
+using web::ParseStatus;
+using web::RequestParser;
+using web::RequestView;
+
+struct Rng {
+    std::uint64_t s;
+    std::uint64_t next() {
+        s ^= s << 13;
+        s ^= s >> 7;
+        s ^= s << 17;
+        return s;
+    }
+    std::size_t below(std::size_t n) { return n == 0 ? 0 : static_cast<std::size_t>(next() % n); }
+};
+
+const char* const kSeeds[] = {
+    "GET / HTTP/1.1\r\nHost: example.com\r\n\r\n",
+    "GET /search?q=hello+world&lang=en HTTP/1.1\r\nHost: example.com\r\nUser-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/126.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\nAccept-Language: en-US,en;q=0.5\r\nAccept-Encoding: gzip, deflate, br\r\nConnection: keep-alive\r\n\r\n",
+    "POST /upload HTTP/1.1\r\nHost: x\r\nContent-Length: 5\r\nContent-Type: text/plain\r\n\r\nhello",
+    "POST /api HTTP/1.1\r\nHost: x\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhello\r\n0\r\n\r\n",
+    "GET /a HTTP/1.0\n\n",
+    "\r\n\r\nGET /lead HTTP/1.1\r\nHost: x\r\n\r\n",
+    "GET /v HTTP/1.1\r\nX-Empty:\r\nX-Pad: \t value \t \r\n\r\n",
+    "OPTIONS * HTTP/1.1\r\nHost: x\r\n\r\n",
+    "GET /ok HTTP/1.1\r\nHost: x\r\n\r\nGET /next HTTP/1.1\r\n\r\n",
+    "GET / HTTP/1.1\r\nBad Header: x\r\n\r\n",
+    "GET /  HTTP/1.1\r\n\r\n",
+    "G(T / HTTP/1.1\r\n\r\n",
+};
+
+const char kInteresting[] = {'\r', '\n', ':', ' ', '\t', '?', '/', '\0', '\x7f', '\x80', 'A', '%'};
+
+std::string mutate(std::string s, Rng& rng) {
+    unsigned rounds = 1 + static_cast<unsigned>(rng.below(4));
+    for (unsigned r = 0; r < rounds; ++r) {
+        std::size_t at = rng.below(s.size() + 1);
+        switch (rng.below(6)) {
+            case 0:
+                if (at < s.size()) s[at] = static_cast<char>(s[at] ^ (1 << rng.below(8)));
+                break;
+            case 1:
+                s.insert(at, 1, kInteresting[rng.below(sizeof(kInteresting))]);
+                break;
+            case 2:
+                if (at < s.size()) s.erase(at, 1 + rng.below(4));
+                break;
+            case 3: {
+                std::size_t from = rng.below(s.size() + 1);
+                std::size_t len = rng.below(16);
+                s.insert(at, s.substr(from, len));
+                break;
+            }
+            case 4:
+                s.insert(at, "X-Fz: " + std::string(rng.below(40), 'v') + "\r\n");
+                break;
+            default:
+                if (at < s.size()) s[at] = static_cast<char>(rng.next());
+                break;
+        }
+    }
+    return s;
+}
+
+bool same_view(const RequestView& a, const RequestView& b) {
+    if (a.method != b.method || a.target != b.target || a.path != b.path || a.query != b.query) return false;
+    if (a.version != b.version || a.head_length != b.head_length || a.header_count != b.header_count) return false;
+    for (std::size_t k = 0; k < a.header_count; ++k) {
+        if (a.headers[k].name != b.headers[k].name || a.headers[k].value != b.headers[k].value) return false;
+    }
+    return true;
+}
+
+const char* status_name(ParseStatus st) {
+    switch (st) {
+        case ParseStatus::Complete: return "Complete";
+        case ParseStatus::NeedMore: return "NeedMore";
+        case ParseStatus::Error: return "Error";
+        case ParseStatus::TooLarge: return "TooLarge";
+    }
+    return "?";
+}
+
+void report(std::string_view input, const char* what, ParseStatus whole, ParseStatus split) {
+    std::fprintf(stderr, "mismatch: %s (one-shot %s, split %s)\ninput (%zu bytes):", what, status_name(whole), status_name(split), input.size());
+    for (unsigned char c : input) std::fprintf(stderr, " %02x", c);
+    std::fprintf(stderr, "\n");
+}
+
+// Returns false and reports on the first disagreement.
+bool check(std::string_view input, std::size_t max_head, Rng& rng) {
+    RequestParser whole;
+    ParseStatus expect = whole.parse(input, max_head);
+
+    RequestParser split;
+    std::string buf;
+    bool bytewise = rng.below(8) == 0;
+    ParseStatus got = ParseStatus::NeedMore;
+    std::size_t fed = 0;
+    while (fed < input.size()) {
+        std::size_t step = bytewise ? 1 : 1 + rng.below(24);
+        if (step > input.size() - fed) step = input.size() - fed;
+        buf.append(input.data() + fed, step);
+        fed += step;
+        got = split.parse(buf, max_head);
+        if (got == ParseStatus::NeedMore) continue;
+        break;
+    }
+    if (got != expect) {
+        report(input, "status", expect, got);
+        return false;
+    }
+    if (expect == ParseStatus::Complete) {
+        if (!same_view(whole.request(), split.request())) {
+            report(input, "view", expect, got);
+            return false;
+        }
+        // The split run must stop on the chunk that completes the head.
+        if (fed < whole.request().head_length || fed - whole.request().head_length >= 24) {
+            report(input, "head length", expect, got);
+            return false;
+        }
+    }
+    // A parser reset after any outcome must behave like a fresh one.
+    split.reset();
+    got = split.parse(input, max_head);
+    if (got != expect) {
+        report(input, "reset", expect, got);
+        return false;
+    }
+    return true;
+}
+
+bool run_one(std::string_view input, Rng& rng) {
+    std::size_t limits[] = {SIZE_MAX, 16 * 1024, 64 + rng.below(256)};
+    for (std::size_t limit : limits) {
+        if (!check(input, limit, rng)) return false;
+    }
+    return true;
+}
+
+}
+
+#if defined(WEB_LIBFUZZER)
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, std::size_t size) {
+    Rng rng{0x9e3779b97f4a7c15ull ^ size};
+    if (!run_one(std::string_view(reinterpret_cast<const char*>(data), size), rng)) std::abort();
+    return 0;
+}
+
+#else
+
+int main(int argc, char** argv) {
+    std::uint64_t seed = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1;
+    std::uint64_t iterations = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 100000;
+    Rng rng{seed * 0x9e3779b97f4a7c15ull + 1};
+    std::vector<std::string> corpus(std::begin(kSeeds), std::end(kSeeds));
+    std::uint64_t complete = 0, errors = 0, partial = 0;
+    for (std::uint64_t it = 0; it < iterations; ++it) {
+        const std::string& base = corpus[rng.below(corpus.size())];
+        std::string input = rng.below(10) == 0 ? base : mutate(base, rng);
+        if (!run_one(input, rng)) return 1;
+        RequestParser p;
+        auto st = p.parse(input);
+        if (st == ParseStatus::Complete) ++complete;
+        else if (st == ParseStatus::NeedMore) ++partial;
+        else ++errors;
+        // Keep a few interesting mutants around so mutations compound.
+        if (st == ParseStatus::Complete && corpus.size() < 256 && rng.below(16) == 0) corpus.push_back(input);
+    }
+    std::printf("%llu inputs: %llu complete, %llu incomplete, %llu rejected\n",
+        static_cast<unsigned long long>(iterations), static_cast<unsigned long long>(complete),
+        static_cast<unsigned long long>(partial), static_cast<unsigned long long>(errors));
+    return 0;
+}
+
+#endif
@@ -0,0 +1,227 @@
+#include "async_runtime.hpp"
+#include "file_util.hpp"
+#include "logger.hpp"
+#include "socket_util.hpp"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace web {
+
+AsyncRuntime& AsyncRuntime::instance() {
+    static AsyncRuntime inst((std::max)(2u, std::thread::hardware_concurrency()));
+    return inst;
+}
+
+AsyncRuntime::AsyncRuntime(unsigned threads) {
+#if defined(__linux__)
+    ep_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.ptr = nullptr;
+    if (ep_ < 0 || wake_fd_ < 0 || epoll_ctl(ep_, EPOLL_CTL_ADD, wake_fd_, &ev) != 0) {
+        // Without both the reactor would spin on a failing epoll_wait; run it
+        // on the timer condition variable instead, as on other platforms.
+        Logger::instance().log(LogLevel::Error, std::string("AsyncRuntime: epoll setup failed (") + std::strerror(errno)
+            + "), readiness waits fall back to timer-driven poll()");
+        if (ep_ >= 0) ::close(ep_);
+        if (wake_fd_ >= 0) ::close(wake_fd_);
+        ep_ = -1;
+        wake_fd_ = -1;
+    }
+#endif
+    for (unsigned i = 0; i < threads; ++i) pool_.emplace_back(&AsyncRuntime::worker, this);
+    reactor_ = std::thread(&AsyncRuntime::reactor, this);
+}
+
+AsyncRuntime::~AsyncRuntime() {
+    shutdown();
+}
+
+void AsyncRuntime::shutdown() {
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (stopping_) return;
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    {
+        std::lock_guard<std::mutex> lk(timer_mtx_);
+    }
+    timer_cv_.notify_all();
+    wake_reactor();
+    if (reactor_.joinable()) reactor_.join();
+    for (auto& t : pool_) {
+        if (t.joinable()) t.join();
+    }
+#if defined(__linux__)
+    if (wake_fd_ >= 0) ::close(wake_fd_);
+    if (ep_ >= 0) ::close(ep_);
+#endif
+}
+
+void AsyncRuntime::post(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        jobs_.push_back(std::move(job));
+    }
+    cv_.notify_one();
+}
+
+void AsyncRuntime::resume(std::coroutine_handle<> h) {
+    post([h] { h.resume(); });
+}
+
+void AsyncRuntime::worker() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lk(mtx_);
+            cv_.wait(lk, [&] { return stopping_ || !jobs_.empty(); });
+            if (jobs_.empty()) return;
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+        job();
+    }
+}
+
+void AsyncRuntime::add_timer(std::chrono::steady_clock::time_point when, std::coroutine_handle<> h) {
+    arm(Timer{when, h});
+}
+
+void AsyncRuntime::arm(Timer t) {
+    bool earliest;
+    {
+        std::lock_guard<std::mutex> lk(timer_mtx_);
+        earliest = timers_.empty() || t.when < timers_.top().when;
+        timers_.push(t);
+    }
+    if (earliest) {
+        timer_cv_.notify_one();
+        wake_reactor();
+    }
+}
+
+void AsyncRuntime::wake_reactor() {
+#if defined(__linux__)
+    if (wake_fd_ >= 0) {
+        std::uint64_t one = 1;
+        ssize_t n = ::write(wake_fd_, &one, sizeof(one));
+        (void)n;
+    }
+#endif
+}
+
+void AsyncRuntime::watch(long long fd, bool write, std::coroutine_handle<> h) {
+#if defined(__linux__)
+    if (ep_ >= 0) {
+        epoll_event ev{};
+        ev.events = (write ? EPOLLOUT : EPOLLIN) | EPOLLRDHUP | EPOLLONESHOT;
+        ev.data.ptr = h.address();
+        if (epoll_ctl(ep_, EPOLL_CTL_ADD, static_cast<int>(fd), &ev) == 0) return;
+        if (errno == EEXIST && epoll_ctl(ep_, EPOLL_CTL_MOD, static_cast<int>(fd), &ev) == 0) return;
+    }
+#endif
+    // No epoll, or it refused the fd (EPERM for a regular file, for one):
+    // poll it from a timer, backing off up to 16 ms while it stays idle. An
+    // fd in an error state polls as ready, so the caller's next read or
+    // write reports the error.
+    constexpr std::chrono::milliseconds first{1};
+    arm(Timer{std::chrono::steady_clock::now() + first, h, fd, write, first});
+}
+
+void AsyncRuntime::reactor() {
+    using clock = std::chrono::steady_clock;
+    while (true) {
+        std::vector<Timer> due;
+        clock::time_point next = clock::now() + std::chrono::seconds(1);
+        {
+            std::unique_lock<std::mutex> lk(timer_mtx_);
+            auto now = clock::now();
+            while (!timers_.empty() && timers_.top().when <= now) {
+                due.push_back(timers_.top());
+                timers_.pop();
+            }
+            if (!timers_.empty()) next = (std::min)(next, timers_.top().when);
+#if defined(__linux__)
+            const bool wait_on_cv = ep_ < 0;
+#else
+            const bool wait_on_cv = true;
+#endif
+            if (wait_on_cv && due.empty()) {
+                bool stop;
+                {
+                    std::lock_guard<std::mutex> jl(mtx_);
+                    stop = stopping_;
+                }
+                if (stop) return;
+                timer_cv_.wait_until(lk, next);
+                continue;
+            }
+        }
+        for (auto& t : due) {
+            if (t.fd >= 0) {
+                bool ready = t.write ? wait_writable(t.fd, std::chrono::milliseconds(0)) : wait_readable(t.fd, std::chrono::milliseconds(0));
+                if (!ready) {
+                    t.backoff = (std::min)(t.backoff * 2, std::chrono::milliseconds(16));
+                    t.when = clock::now() + t.backoff;
+                    std::lock_guard<std::mutex> lk(timer_mtx_);
+                    timers_.push(t);
+                    continue;
+                }
+            }
+            resume(t.h);
+        }
+        if (!due.empty()) continue;
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            if (stopping_) return;
+        }
+#if defined(__linux__)
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next - clock::now()).count() + 1;
+        epoll_event events[64];
+        int n = epoll_wait(ep_, events, 64, static_cast<int>(wait < 0 ? 0 : wait));
+        for (int i = 0; i < n; ++i) {
+            if (!events[i].data.ptr) {
+                std::uint64_t v;
+                while (::read(wake_fd_, &v, sizeof(v)) > 0) {}
+                continue;
+            }
+            resume(std::coroutine_handle<>::from_address(events[i].data.ptr));
+        }
+#endif
+    }
+}
+
+void FileReadAwaiter::await_suspend(std::coroutine_handle<> h) {
+    AsyncRuntime::instance().post([this, h] {
+        result = read_file(path);
+        h.resume();
+    });
+}
+
+SleepAwaiter sleep_for(std::chrono::milliseconds d) {
+    return SleepAwaiter{std::chrono::steady_clock::now() + d};
+}
+
+ReadyAwaiter readable(long long fd) {
+    return ReadyAwaiter{fd, false};
+}
+
+ReadyAwaiter writable(long long fd) {
+    return ReadyAwaiter{fd, true};
+}
+
+FileReadAwaiter read_file_async(std::string path) {
+    return FileReadAwaiter{std::move(path), std::nullopt};
+}
+
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace web {
+
+// Shared runtime for coroutine handlers: one reactor thread waits on socket
+// readiness (epoll on Linux) and timers, and a small fixed pool resumes the
+// coroutines and runs offloaded blocking work such as file reads. Without
+// epoll, or for an fd epoll refuses, a readiness wait is a timer that checks
+// the fd with a zero-timeout poll() each time it fires.
+class AsyncRuntime {
+public:
+    static AsyncRuntime& instance();
+    ~AsyncRuntime();
+    AsyncRuntime(const AsyncRuntime&) = delete;
+    AsyncRuntime& operator=(const AsyncRuntime&) = delete;
+    void post(std::function<void()> job);
+    void resume(std::coroutine_handle<> h);
+    void add_timer(std::chrono::steady_clock::time_point when, std::coroutine_handle<> h);
+    void watch(long long fd, bool write, std::coroutine_handle<> h);
+    void shutdown();
+private:
+    AsyncRuntime(unsigned threads);
+    struct Timer {
+        std::chrono::steady_clock::time_point when;
+        std::coroutine_handle<> h;
+        // Set for polled readiness waits; the timer re-arms until fd is ready.
+        long long fd = -1;
+        bool write = false;
+        std::chrono::milliseconds backoff{0};
+        bool operator>(const Timer& o) const { return when > o.when; }
+    };
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> jobs_;
+    bool stopping_ = false;
+    std::vector<std::thread> pool_;
+    std::mutex timer_mtx_;
+    std::condition_variable timer_cv_;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers_;
+    std::thread reactor_;
+    int ep_ = -1;
+    int wake_fd_ = -1;
+    void worker();
+    void reactor();
+    void wake_reactor();
+    void arm(Timer t);
+};
+
+struct SleepAwaiter {
+    std::chrono::steady_clock::time_point when;
+    bool await_ready() const noexcept { return when <= std::chrono::steady_clock::now(); }
+    void await_suspend(std::coroutine_handle<> h) { AsyncRuntime::instance().add_timer(when, h); }
+    void await_resume() const noexcept {}
+};
+
+struct ReadyAwaiter {
+    long long fd;
+    bool write;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) { AsyncRuntime::instance().watch(fd, write, h); }
+    void await_resume() const noexcept {}
+};
+
+struct FileReadAwaiter {
+    std::string path;
+    std::optional<std::string> result;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h);
+    std::optional<std::string> await_resume() { return std::move(result); }
+};
+
+SleepAwaiter sleep_for(std::chrono::milliseconds d);
+ReadyAwaiter readable(long long fd);
+ReadyAwaiter writable(long long fd);
+FileReadAwaiter read_file_async(std::string path);
+
+}
@@ -1,5 +1,7 @@
 #include "ccss.hpp"
 #include "file_util.hpp"
+#include "logger.hpp"
+#include <algorithm>
 #include <unordered_map>
 #include <vector>
 #include <string>
@@ -164,8 +166,14 @@ static std::string apply_mixin(const Mixin& m, const std::vector<std::string>& a
 }
 
 std::string compile_ccss(const std::string& source, const std::unordered_map<std::string,std::string>* overrides, const std::string& base_dir) {
+    std::vector<std::string> imports;
+    return compile_ccss(source, overrides, base_dir, imports);
+}
+
+std::string compile_ccss(const std::string& source, const std::unordered_map<std::string,std::string>* overrides, const std::string& base_dir, std::vector<std::string>& imports) {
     std::set<std::string> visited;
     std::string src = expand_imports(source, base_dir, visited);
+    imports.assign(visited.begin(), visited.end());
     std::vector<std::unordered_map<std::string,std::string>> var_stack;
     var_stack.emplace_back();
     if (overrides) {
@@ -352,4 +360,101 @@ std::string compile_ccss(const std::string& source, const std::unordered_map<std
 #endif
 }
 
+static std::uint64_t fnv1a(std::uint64_t h, const std::string& s) {
+    std::uint64_t n = s.size();
+    for (int i = 0; i < 8; ++i) {
+        h ^= (n >> (i * 8)) & 0xff;
+        h *= 1099511628211ull;
+    }
+    for (unsigned char c : s) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+CcssCache::CcssCache(std::string base_dir, std::size_t capacity, std::chrono::milliseconds check_interval)
+    : base_dir_(std::move(base_dir)), capacity_(capacity == 0 ? 1 : capacity), interval_(check_interval) {}
+
+std::string CcssCache::canonical(const std::string& entry, const std::unordered_map<std::string,std::string>* overrides) {
+    std::string key = entry;
+    if (!overrides || overrides->empty()) return key;
+    std::vector<std::pair<std::string,std::string>> sorted(overrides->begin(), overrides->end());
+    std::sort(sorted.begin(), sorted.end());
+    for (auto& [k, v] : sorted) {
+        key.push_back('\0');
+        key += k;
+        key.push_back('\0');
+        key += v;
+    }
+    return key;
+}
+
+bool CcssCache::stale(const Entry& e) const {
+    for (auto& d : e.deps) {
+        std::int64_t mtime = 0;
+        std::uint64_t size = 0;
+        if (!file_stamp(d.path, mtime, size)) return true;
+        if (mtime != d.mtime || size != d.size) return true;
+    }
+    return false;
+}
+
+std::shared_ptr<const std::string> CcssCache::get(const std::string& entry, const std::unordered_map<std::string,std::string>* overrides) {
+    std::string key = canonical(entry, overrides);
+    std::uint64_t h = fnv1a(14695981039346656037ull, key);
+    auto now = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        auto it = index_.find(h);
+        if (it != index_.end() && it->second->key == key) {
+            Entry& e = *it->second;
+            bool fresh = now - e.checked < interval_;
+            if (!fresh && !stale(e)) {
+                // Only a real stamp check restarts the window; hits inside it must not.
+                e.checked = now;
+                fresh = true;
+            }
+            if (fresh) {
+                lru_.splice(lru_.begin(), lru_, it->second);
+                return e.css;
+            }
+        }
+    }
+    Entry fresh;
+    fresh.key = key;
+    fresh.checked = now;
+    std::string full = join_paths(base_dir_, entry);
+    std::int64_t mtime = 0;
+    std::uint64_t size = 0;
+    if (!file_stamp(full, mtime, size)) return nullptr;
+    auto src = read_file(full);
+    if (!src) return nullptr;
+    fresh.deps.push_back(Dep{full, mtime, size});
+    std::vector<std::string> imports;
+    auto css = compile_ccss(*src, overrides, base_dir_, imports);
+    for (auto& p : imports) {
+        Dep d{p, 0, 0};
+        file_stamp(p, d.mtime, d.size);
+        fresh.deps.push_back(std::move(d));
+    }
+    fresh.css = std::make_shared<const std::string>(std::move(css));
+    Logger::instance().log(LogLevel::Debug, "CCSS compiled " + entry + " size " + std::to_string(fresh.css->size()));
+    auto result = fresh.css;
+    std::lock_guard<std::mutex> lk(mtx_);
+    auto it = index_.find(h);
+    if (it != index_.end()) {
+        lru_.erase(it->second);
+        index_.erase(it);
+    }
+    while (index_.size() >= capacity_ && !lru_.empty()) {
+        index_.erase(lru_.back().hash);
+        lru_.pop_back();
+    }
+    fresh.hash = h;
+    lru_.push_front(std::move(fresh));
+    index_[h] = lru_.begin();
+    return result;
+}
+
 }
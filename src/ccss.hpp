@@ -1,10 +1,47 @@
 #pragma once
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace web {
 
 std::string compile_ccss(const std::string& source, const std::unordered_map<std::string,std::string>* overrides = nullptr);
 std::string compile_ccss(const std::string& source, const std::unordered_map<std::string,std::string>* overrides, const std::string& base_dir);
+std::string compile_ccss(const std::string& source, const std::unordered_map<std::string,std::string>* overrides, const std::string& base_dir, std::vector<std::string>& imports);
+
+// Bounded LRU of compiled stylesheets keyed by entry file plus a canonical
+// hash of the variable overrides. Entries record the mtime/size of every
+// file in their import closure and are re-checked once per interval.
+class CcssCache {
+public:
+    explicit CcssCache(std::string base_dir, std::size_t capacity = 64, std::chrono::milliseconds check_interval = std::chrono::milliseconds(1000));
+    std::shared_ptr<const std::string> get(const std::string& entry, const std::unordered_map<std::string,std::string>* overrides = nullptr);
+private:
+    struct Dep {
+        std::string path;
+        std::int64_t mtime;
+        std::uint64_t size;
+    };
+    struct Entry {
+        std::uint64_t hash = 0;
+        std::string key;
+        std::shared_ptr<const std::string> css;
+        std::vector<Dep> deps;
+        std::chrono::steady_clock::time_point checked;
+    };
+    std::string base_dir_;
+    std::size_t capacity_;
+    std::chrono::milliseconds interval_;
+    std::mutex mtx_;
+    std::list<Entry> lru_;
+    std::unordered_map<std::uint64_t, std::list<Entry>::iterator> index_;
+    static std::string canonical(const std::string& entry, const std::unordered_map<std::string,std::string>* overrides);
+    bool stale(const Entry& e) const;
+};
 
 }
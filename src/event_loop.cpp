@@ -0,0 +1,364 @@
+#include "event_loop.hpp"
+#include "socket_util.hpp"
+#include "logger.hpp"
+#include "metrics.hpp"
+
+#if defined(__linux__)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace web {
+
+#if defined(__linux__)
+
+AsyncPost mailbox_post(std::shared_ptr<LoopMailbox> box) {
+    return [box = std::move(box)](std::shared_ptr<AsyncCall> call) {
+        std::lock_guard<std::mutex> lk(box->mtx);
+        if (box->closed) return;
+        bool first = box->done.empty();
+        box->done.push_back(std::move(call));
+        if (first) {
+            uint64_t one = 1;
+            ssize_t n = ::write(box->wake_fd, &one, sizeof(one));
+            (void)n;
+        }
+    };
+}
+
+std::vector<std::shared_ptr<AsyncCall>> mailbox_take(LoopMailbox& box, bool close) {
+    std::vector<std::shared_ptr<AsyncCall>> done;
+    std::lock_guard<std::mutex> lk(box.mtx);
+    done.swap(box.done);
+    if (close) box.closed = true;
+    return done;
+}
+
+static constexpr int kMaxEvents = 256;
+static constexpr int kTickMs = 100;
+static constexpr int kIdleWaitMs = 1000;
+static constexpr std::chrono::milliseconds kAcceptBackoff{250};
+
+EventLoop::EventLoop(const Router& router, const ServerConfig& cfg, long long listen_fd)
+    : router_(router), cfg_(cfg), listen_fd_(listen_fd), wheel_(std::chrono::milliseconds(kTickMs)) {
+    ep_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (ep_ < 0 || wake_fd_ < 0) return;
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = wake_fd_;
+    epoll_ctl(ep_, EPOLL_CTL_ADD, wake_fd_, &ev);
+    ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+    ev.data.fd = static_cast<int>(listen_fd_);
+    epoll_ctl(ep_, EPOLL_CTL_ADD, static_cast<int>(listen_fd_), &ev);
+    mailbox_ = std::make_shared<LoopMailbox>();
+    mailbox_->wake_fd = wake_fd_;
+    post_ = mailbox_post(mailbox_);
+}
+
+EventLoop::~EventLoop() {
+    if (mailbox_) mailbox_take(*mailbox_, true);
+    for (auto& [fd, c] : conns_) {
+        ::close(fd);
+        Metrics::instance().connection_closed();
+    }
+    conns_.clear();
+    if (wake_fd_ >= 0) ::close(wake_fd_);
+    if (ep_ >= 0) ::close(ep_);
+}
+
+bool EventLoop::supported() {
+    return true;
+}
+
+bool EventLoop::ok() const {
+    return ep_ >= 0 && wake_fd_ >= 0;
+}
+
+void EventLoop::stop() {
+    running_ = false;
+    uint64_t one = 1;
+    if (wake_fd_ >= 0) {
+        ssize_t n = ::write(wake_fd_, &one, sizeof(one));
+        (void)n;
+    }
+}
+
+void EventLoop::stop_accepting() {
+    if (!accepting_.exchange(false) || ep_ < 0) return;
+    epoll_ctl(ep_, EPOLL_CTL_DEL, static_cast<int>(listen_fd_), nullptr);
+}
+
+void EventLoop::expire_idle() {
+    rearm_ = true;
+    uint64_t one = 1;
+    if (wake_fd_ >= 0) {
+        ssize_t n = ::write(wake_fd_, &one, sizeof(one));
+        (void)n;
+    }
+}
+
+void EventLoop::run() {
+    running_ = true;
+    epoll_event events[kMaxEvents];
+    while (running_) {
+        int n = epoll_wait(ep_, events, kMaxEvents, wheel_.size() > 0 ? kTickMs : kIdleWaitMs);
+        auto now = std::chrono::steady_clock::now();
+        wheel_.advance(now, [this, now](TimerWheel::Node& node) {
+            if (&node == &accept_retry_) resume_accept();
+            else on_deadline(static_cast<Conn&>(node), now);
+        });
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            Logger::instance().log(LogLevel::Error, "epoll_wait failed: " + std::to_string(errno));
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == wake_fd_) {
+                uint64_t v;
+                while (::read(wake_fd_, &v, sizeof(v)) > 0) {}
+                if (rearm_.exchange(false)) {
+                    for (auto& [cfd, c] : conns_) arm(*c);
+                }
+                run_completions();
+                continue;
+            }
+            if (fd == static_cast<int>(listen_fd_)) {
+                if (accepting_) on_accept();
+                else epoll_ctl(ep_, EPOLL_CTL_DEL, static_cast<int>(listen_fd_), nullptr);
+                continue;
+            }
+            auto it = conns_.find(fd);
+            if (it == conns_.end()) continue;
+            Conn& c = *it->second;
+            uint32_t e = events[i].events;
+            if (e & (EPOLLERR | EPOLLHUP)) {
+                close_conn(c);
+                continue;
+            }
+            if (e & EPOLLIN) {
+                on_readable(c);
+                continue;
+            }
+            if (e & EPOLLOUT) settle(c);
+        }
+    }
+}
+
+void EventLoop::on_accept() {
+    while (true) {
+        sockaddr_in caddr{};
+        socklen_t clen = sizeof(caddr);
+        int c = ::accept4(static_cast<int>(listen_fd_), (sockaddr*)&caddr, &clen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (c < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) pause_accept(errno);
+            return;
+        }
+        if (accept_starved_) {
+            accept_starved_ = false;
+            Logger::instance().log(LogLevel::Info, "Accepting connections again");
+        }
+        char ipbuf[INET_ADDRSTRLEN]{};
+        inet_ntop(AF_INET, &caddr.sin_addr, ipbuf, sizeof(ipbuf));
+        auto conn = std::make_unique<Conn>();
+        conn->fd = c;
+        conn->serial = ++next_serial_;
+        conn->session.tag = (static_cast<std::uint64_t>(conn->serial) << 32) | static_cast<std::uint32_t>(c);
+        conn->session.remote = std::string(ipbuf) + ":" + std::to_string(ntohs(caddr.sin_port));
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.fd = c;
+        if (epoll_ctl(ep_, EPOLL_CTL_ADD, c, &ev) != 0) {
+            ::close(c);
+            continue;
+        }
+        arm(*conn);
+        conns_[c] = std::move(conn);
+        Metrics::instance().connection_opened();
+    }
+}
+
+// The listener is level-triggered: while accept() keeps failing for lack of
+// descriptors the pending connection stays queued and the loop would spin.
+// Take the listener out of the epoll set and retry after a short backoff.
+void EventLoop::pause_accept(int err) {
+    if (accept_retry_.scheduled()) return;
+    epoll_ctl(ep_, EPOLL_CTL_DEL, static_cast<int>(listen_fd_), nullptr);
+    wheel_.schedule(accept_retry_, std::chrono::steady_clock::now() + kAcceptBackoff);
+    if (!accept_starved_) {
+        accept_starved_ = true;
+        Logger::instance().log(LogLevel::Warn, std::string("accept failed: ") + std::strerror(err) + "; pausing accepts for "
+            + std::to_string(kAcceptBackoff.count()) + " ms at a time until descriptors free up");
+    }
+}
+
+void EventLoop::resume_accept() {
+    if (!accepting_) return;
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+    ev.data.fd = static_cast<int>(listen_fd_);
+    epoll_ctl(ep_, EPOLL_CTL_ADD, static_cast<int>(listen_fd_), &ev);
+}
+
+void EventLoop::on_readable(Conn& c) {
+    char buf[16384];
+    bool eof = false;
+    c.read_paused = false;
+    while (true) {
+        // Parse as the buffer fills rather than draining the socket first;
+        // if that frees nothing (async handler pending, or an error is
+        // queued) reading pauses and resumes from run_completions.
+        if (input_full(c.session, cfg_)) {
+            process_input(c.session, router_, cfg_, &post_);
+            if (c.session.close_after_write) break;
+            if (input_full(c.session, cfg_)) {
+                c.read_paused = true;
+                break;
+            }
+        }
+        ssize_t n = ::recv(c.fd, buf, sizeof(buf), 0);
+        if (n > 0) {
+            append_input(c.session, buf, static_cast<size_t>(n));
+            continue;
+        }
+        if (n == 0) { eof = true; break; }
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+        close_conn(c);
+        return;
+    }
+    process_input(c.session, router_, cfg_, &post_);
+    if (eof) reject_incomplete(c.session);
+    settle(c);
+}
+
+void EventLoop::run_completions() {
+    for (auto& call : mailbox_take(*mailbox_)) {
+        auto it = conns_.find(static_cast<int>(call->tag & 0xffffffffu));
+        if (it == conns_.end() || it->second->serial != static_cast<std::uint32_t>(call->tag >> 32)) continue;
+        Conn& c = *it->second;
+        complete_async(c.session, *call, router_, cfg_, &post_);
+        if (c.read_paused && !input_full(c.session, cfg_)) {
+            on_readable(c);
+            continue;
+        }
+        settle(c);
+    }
+}
+
+bool EventLoop::flush(Conn& c) {
+    return flush_output(c.session, c.fd) != IoStatus::WouldBlock;
+}
+
+void EventLoop::settle(Conn& c) {
+    if (flush(c) && c.session.close_after_write && !c.session.awaiting) {
+        close_conn(c);
+        return;
+    }
+    arm(c);
+}
+
+void EventLoop::arm(Conn& c) {
+    TimerWheel::Clock::time_point at;
+    if (next_deadline(c.session, cfg_, at) == Deadline::None) {
+        wheel_.cancel(c);
+        return;
+    }
+    if (c.scheduled() && c.deadline_at <= at) return;
+    c.deadline_at = at;
+    wheel_.schedule(c, at);
+}
+
+void EventLoop::on_deadline(Conn& c, TimerWheel::Clock::time_point now) {
+    TimerWheel::Clock::time_point at;
+    auto kind = next_deadline(c.session, cfg_, at);
+    if (kind == Deadline::None) return;
+    if (at > now) {
+        c.deadline_at = at;
+        wheel_.schedule(c, at);
+        return;
+    }
+    expire_deadline(c.session, kind);
+    if (kind == Deadline::Write) {
+        close_conn(c);
+        return;
+    }
+    settle(c);
+}
+
+void EventLoop::close_conn(Conn& c) {
+    int fd = c.fd;
+    wheel_.cancel(c);
+    epoll_ctl(ep_, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    conns_.erase(fd);
+    Metrics::instance().connection_closed();
+}
+
+#else
+
+AsyncPost mailbox_post(std::shared_ptr<LoopMailbox>) {
+    return {};
+}
+
+std::vector<std::shared_ptr<AsyncCall>> mailbox_take(LoopMailbox& box, bool close) {
+    std::vector<std::shared_ptr<AsyncCall>> done;
+    std::lock_guard<std::mutex> lk(box.mtx);
+    done.swap(box.done);
+    if (close) box.closed = true;
+    return done;
+}
+
+EventLoop::EventLoop(const Router& router, const ServerConfig& cfg, long long listen_fd)
+    : router_(router), cfg_(cfg), listen_fd_(listen_fd), wheel_(std::chrono::milliseconds(1)) {}
+
+EventLoop::~EventLoop() = default;
+
+bool EventLoop::supported() {
+    return false;
+}
+
+bool EventLoop::ok() const {
+    return false;
+}
+
+void EventLoop::run() {}
+
+void EventLoop::stop() {}
+
+void EventLoop::stop_accepting() {}
+
+void EventLoop::expire_idle() {}
+
+void EventLoop::on_accept() {}
+
+void EventLoop::on_readable(Conn&) {}
+
+bool EventLoop::flush(Conn&) {
+    return true;
+}
+
+void EventLoop::close_conn(Conn&) {}
+
+void EventLoop::run_completions() {}
+
+void EventLoop::settle(Conn&) {}
+
+void EventLoop::arm(Conn&) {}
+
+void EventLoop::on_deadline(Conn&, TimerWheel::Clock::time_point) {}
+
+#endif
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include "router.hpp"
+#include "session.hpp"
+#include "server_config.hpp"
+#include "timer_wheel.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace web {
+
+// Completed async handlers waiting to be picked up by a loop thread. Shared
+// with the handlers' AsyncPost so late completions after the loop is
+// destroyed are dropped instead of touching freed memory.
+struct LoopMailbox {
+    std::mutex mtx;
+    std::vector<std::shared_ptr<AsyncCall>> done;
+    int wake_fd = -1;
+    bool closed = false;
+};
+
+// Posts to box and, on the first pending completion, bumps its eventfd.
+AsyncPost mailbox_post(std::shared_ptr<LoopMailbox> box);
+// Takes the queued completions; with close, later posts are dropped.
+std::vector<std::shared_ptr<AsyncCall>> mailbox_take(LoopMailbox& box, bool close = false);
+
+// Edge-triggered epoll reactor. Each loop owns its connections; the listen
+// socket may be shared between loops (EPOLLEXCLUSIVE avoids herd wakeups).
+class EventLoop {
+public:
+    EventLoop(const Router& router, const ServerConfig& cfg, long long listen_fd);
+    ~EventLoop();
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+    bool ok() const;
+    void run();
+    void stop();
+    // Drops the listen socket from this loop; open connections are kept.
+    void stop_accepting();
+    // Re-arms every connection's deadline on the loop thread, so idle
+    // keep-alive connections close promptly once a drain has begun.
+    void expire_idle();
+    static bool supported();
+private:
+    // The wheel node is scheduled no later than the session's current
+    // deadline; when it fires early the deadline is recomputed and re-armed.
+    struct Conn : TimerWheel::Node {
+        int fd;
+        std::uint32_t serial;
+        Session session;
+        TimerWheel::Clock::time_point deadline_at;
+        bool read_paused = false;
+    };
+    const Router& router_;
+    const ServerConfig& cfg_;
+    long long listen_fd_;
+    int ep_{-1};
+    int wake_fd_{-1};
+    std::atomic<bool> running_{false};
+    std::atomic<bool> accepting_{true};
+    std::atomic<bool> rearm_{false};
+    std::unordered_map<int, std::unique_ptr<Conn>> conns_;
+    std::uint32_t next_serial_{0};
+    TimerWheel wheel_;
+    // Scheduled while the listener is out of the epoll set after accept()
+    // ran out of descriptors; it re-adds the listener when it fires.
+    TimerWheel::Node accept_retry_;
+    bool accept_starved_{false};
+    std::shared_ptr<LoopMailbox> mailbox_;
+    AsyncPost post_;
+    void run_completions();
+    void on_accept();
+    void pause_accept(int err);
+    void resume_accept();
+    void on_readable(Conn& c);
+    bool flush(Conn& c);
+    void settle(Conn& c);
+    void arm(Conn& c);
+    void on_deadline(Conn& c, TimerWheel::Clock::time_point now);
+    void close_conn(Conn& c);
+};
+
+}
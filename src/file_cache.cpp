@@ -0,0 +1,99 @@
+#include "file_cache.hpp"
+#include <sys/stat.h>
+#include <fcntl.h>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace web {
+
+OpenFile::~OpenFile() {
+    if (fd < 0) return;
+#if defined(_WIN32)
+    _close(fd);
+#else
+    close(fd);
+#endif
+}
+
+static std::shared_ptr<const OpenFile> open_regular(const std::string& path) {
+#if defined(_WIN32)
+    int fd = _open(path.c_str(), _O_RDONLY | _O_BINARY);
+    if (fd < 0) return nullptr;
+    struct _stat64 st;
+    if (_fstat64(fd, &st) != 0 || !(st.st_mode & _S_IFREG)) {
+        _close(fd);
+        return nullptr;
+    }
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return nullptr;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return nullptr;
+    }
+#endif
+    auto f = std::make_shared<OpenFile>();
+    f->fd = fd;
+    f->size = static_cast<std::uint64_t>(st.st_size);
+    f->mtime = static_cast<std::int64_t>(st.st_mtime);
+    f->inode = static_cast<std::uint64_t>(st.st_ino);
+    return f;
+}
+
+static bool unchanged(const std::string& path, const OpenFile& f) {
+#if defined(_WIN32)
+    struct _stat64 st;
+    if (_stat64(path.c_str(), &st) != 0) return false;
+#else
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return false;
+#endif
+    return static_cast<std::uint64_t>(st.st_size) == f.size
+        && static_cast<std::int64_t>(st.st_mtime) == f.mtime
+        && static_cast<std::uint64_t>(st.st_ino) == f.inode;
+}
+
+FileCache::FileCache(std::size_t capacity, std::chrono::milliseconds revalidate)
+    : capacity_(capacity == 0 ? 1 : capacity), revalidate_(revalidate) {}
+
+std::shared_ptr<const OpenFile> FileCache::open(const std::string& path) {
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lk(mtx_);
+    auto it = entries_.find(path);
+    if (it != entries_.end()) {
+        Entry& e = it->second;
+        bool fresh = now - e.checked < revalidate_;
+        if (!fresh && unchanged(path, *e.file)) {
+            // Only a real stat restarts the window; hits inside it must not.
+            e.checked = now;
+            fresh = true;
+        }
+        if (fresh) {
+            lru_.splice(lru_.begin(), lru_, e.lru);
+            return e.file;
+        }
+        lru_.erase(e.lru);
+        entries_.erase(it);
+    }
+    auto f = open_regular(path);
+    if (!f) return nullptr;
+    while (entries_.size() >= capacity_ && !lru_.empty()) {
+        entries_.erase(lru_.back());
+        lru_.pop_back();
+    }
+    lru_.push_front(path);
+    entries_[path] = Entry{f, now, lru_.begin()};
+    return f;
+}
+
+void FileCache::clear() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    entries_.clear();
+    lru_.clear();
+}
+
+}
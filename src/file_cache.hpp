@@ -0,0 +1,45 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace web {
+
+struct OpenFile {
+    int fd = -1;
+    std::uint64_t size = 0;
+    std::int64_t mtime = 0;
+    std::uint64_t inode = 0;
+    OpenFile() = default;
+    OpenFile(const OpenFile&) = delete;
+    OpenFile& operator=(const OpenFile&) = delete;
+    ~OpenFile();
+};
+
+// Bounded LRU of open descriptors and their fstat results. Entries are
+// re-validated with stat() at most once per revalidate interval; evicted
+// descriptors stay open until the last in-flight response releases them.
+class FileCache {
+public:
+    explicit FileCache(std::size_t capacity = 256, std::chrono::milliseconds revalidate = std::chrono::milliseconds(1000));
+    std::shared_ptr<const OpenFile> open(const std::string& path);
+    void clear();
+private:
+    struct Entry {
+        std::shared_ptr<const OpenFile> file;
+        std::chrono::steady_clock::time_point checked;
+        std::list<std::string>::iterator lru;
+    };
+    std::size_t capacity_;
+    std::chrono::milliseconds revalidate_;
+    std::mutex mtx_;
+    std::list<std::string> lru_;
+    std::unordered_map<std::string, Entry> entries_;
+};
+
+}
@@ -25,6 +25,19 @@ bool file_exists(const std::string& path) {
 #endif
 }
 
+bool file_stamp(const std::string& path, std::int64_t& mtime, std::uint64_t& size) {
+#if defined(_WIN32)
+    struct _stat64 s;
+    if (_stat64(path.c_str(), &s) != 0) return false;
+#else
+    struct stat s;
+    if (stat(path.c_str(), &s) != 0) return false;
+#endif
+    mtime = static_cast<std::int64_t>(s.st_mtime);
+    size = static_cast<std::uint64_t>(s.st_size);
+    return true;
+}
+
 static bool ends_with(const std::string& s, const std::string& suf) {
     if (s.size() < suf.size()) return false;
     return std::equal(s.end() - suf.size(), s.end(), suf.begin(), suf.end());
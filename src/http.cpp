@@ -1,7 +1,11 @@
 #include "http.hpp"
+#include "file_cache.hpp"
 #include <sstream>
 #include <algorithm>
 #include <cctype>
+#include <ctime>
+#include <atomic>
+#include <charconv>
 
 namespace web {
 
@@ -12,7 +16,7 @@ static std::string trim(const std::string& s) {
     return s.substr(b, e - b + 1);
 }
 
-static std::unordered_map<std::string, std::string> parse_query(const std::string& q) {
+std::unordered_map<std::string, std::string> parse_query(const std::string& q) {
     std::unordered_map<std::string, std::string> m;
     std::stringstream ss(q);
     std::string kv;
@@ -35,7 +39,7 @@ Request parse_request(const std::string& data) {
         if (!line.empty() && line.back() == '\r') line.pop_back();
         std::istringstream l(line);
         std::string target;
-        l >> r.method >> target;
+        l >> r.method >> target >> r.version;
         r.raw_target = target;
         auto qpos = target.find('?');
         if (qpos == std::string::npos) {
@@ -61,68 +65,220 @@ Request parse_request(const std::string& data) {
     return r;
 }
 
-static std::string reason_phrase(int status) {
+static const char* reason_phrase(int status) {
     switch (status) {
+        case 100: return "Continue";
         case 200: return "OK";
         case 201: return "Created";
         case 204: return "No Content";
         case 301: return "Moved Permanently";
         case 302: return "Found";
+        case 304: return "Not Modified";
         case 400: return "Bad Request";
         case 401: return "Unauthorized";
         case 403: return "Forbidden";
         case 404: return "Not Found";
         case 405: return "Method Not Allowed";
+        case 408: return "Request Timeout";
         case 413: return "Payload Too Large";
+        case 417: return "Expectation Failed";
+        case 431: return "Request Header Fields Too Large";
         case 500: return "Internal Server Error";
         case 501: return "Not Implemented";
+        case 503: return "Service Unavailable";
         default: return "OK";
     }
 }
 
-static std::string http_date() {
-    std::time_t t = std::time(nullptr);
-    std::tm gm{};
+namespace {
+
+struct StatusLines {
+    std::string lines[600];
+    StatusLines() {
+        for (int code = 100; code < 600; ++code) {
+            lines[code] = "HTTP/1.1 " + std::to_string(code) + " " + reason_phrase(code) + "\r\n";
+        }
+    }
+};
+
+std::atomic<std::int64_t> date_second{0};
+
+std::int64_t now_second() {
+    auto t = date_second.load(std::memory_order_relaxed);
+    return t != 0 ? t : static_cast<std::int64_t>(std::time(nullptr));
+}
+
+}
+
+static const StatusLines& status_lines() {
+    static const StatusLines table;
+    return table;
+}
+
+void tick_http_date() {
+    date_second.store(static_cast<std::int64_t>(std::time(nullptr)), std::memory_order_relaxed);
+}
+
+std::string_view http_date_now() {
+    struct Cached {
+        std::int64_t second = -1;
+        char buf[64];
+        std::size_t len = 0;
+    };
+    thread_local Cached c;
+    auto sec = now_second();
+    if (sec != c.second) {
+        std::time_t t = static_cast<std::time_t>(sec);
+        std::tm gm{};
 #if defined(_WIN32)
-    gmtime_s(&gm, &t);
+        gmtime_s(&gm, &t);
 #else
-    gmtime_r(&t, &gm);
+        gmtime_r(&t, &gm);
 #endif
-    char buf[64];
-    std::strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &gm);
-    return std::string(buf);
+        c.len = std::strftime(c.buf, sizeof(c.buf), "%a, %d %b %Y %H:%M:%S GMT", &gm);
+        c.second = sec;
+    }
+    return std::string_view(c.buf, c.len);
 }
 
-std::string Response::to_string() const {
-    std::ostringstream out;
-    std::string r = reason.empty() ? reason_phrase(status) : reason;
-    out << "HTTP/1.1 " << status << " " << r << "\r\n";
-    auto it = headers.find("Content-Length");
-    if (it == headers.end()) {
-        out << "Content-Length: " << body.size() << "\r\n";
+// Case-insensitive, like find_header(): the head must be framed by the same
+// rule streams_chunked() and content_length() use for the body.
+static bool key_is(const std::string& k, std::string_view name) {
+    if (k.size() != name.size()) return false;
+    for (std::size_t i = 0; i < k.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(k[i])) != std::tolower(static_cast<unsigned char>(name[i]))) return false;
+    }
+    return true;
+}
+
+static void append_uint(std::string& out, std::uint64_t v) {
+    char buf[24];
+    auto r = std::to_chars(buf, buf + sizeof(buf), v);
+    out.append(buf, static_cast<std::size_t>(r.ptr - buf));
+}
+
+void append_chunk(std::string& out, std::string_view data, bool last) {
+    static constexpr char kHex[] = "0123456789abcdef";
+    if (!data.empty()) {
+        char buf[16];
+        std::size_t n = sizeof(buf);
+        std::uint64_t v = data.size();
+        do {
+            buf[--n] = kHex[v & 15];
+            v >>= 4;
+        } while (v);
+        out.append(buf + n, sizeof(buf) - n);
+        out += "\r\n";
+        out.append(data.data(), data.size());
+        out += "\r\n";
+    }
+    if (last) out += "0\r\n\r\n";
+}
+
+std::uint64_t Response::content_length() const {
+    if (stream) {
+        auto v = find_header(headers, "Content-Length");
+        std::uint64_t n = 0;
+        if (v) std::from_chars(v->data(), v->data() + v->size(), n);
+        return n;
     }
-    if (headers.find("Date") == headers.end()) {
-        out << "Date: " << http_date() << "\r\n";
+    return file ? file->size : body.size();
+}
+
+bool Response::streams_chunked() const {
+    return stream && chunked && !find_header(headers, "Content-Length");
+}
+
+void Response::serialize_head(std::string& out, bool with_date) const {
+    static constexpr std::string_view kServer = "Server: WebServerEngine/1.0\r\n";
+    static constexpr std::string_view kNosniff = "X-Content-Type-Options: nosniff\r\n";
+    bool has_length = false, has_date = false, has_server = false, has_nosniff = false;
+    std::size_t need = 160;
+    for (auto& [k, v] : headers) {
+        has_length = has_length || key_is(k, "Content-Length");
+        has_date = has_date || key_is(k, "Date");
+        has_server = has_server || key_is(k, "Server");
+        has_nosniff = has_nosniff || key_is(k, "X-Content-Type-Options");
+        need += k.size() + v.size() + 4;
     }
-    if (headers.find("Server") == headers.end()) {
-        out << "Server: WebServerEngine/1.0\r\n";
+    out.reserve(out.size() + need);
+    if (reason.empty() && status >= 100 && status < 600) {
+        out += status_lines().lines[status];
+    } else {
+        out += "HTTP/1.1 ";
+        append_uint(out, static_cast<std::uint64_t>(status < 0 ? 0 : status));
+        out += ' ';
+        out += reason.empty() ? reason_phrase(status) : reason;
+        out += "\r\n";
     }
-    if (headers.find("X-Content-Type-Options") == headers.end()) {
-        out << "X-Content-Type-Options: nosniff\r\n";
+    if (stream) {
+        if (streams_chunked()) out += "Transfer-Encoding: chunked\r\n";
+    } else if (!has_length) {
+        out += "Content-Length: ";
+        append_uint(out, content_length());
+        out += "\r\n";
     }
-    for (auto it2 = headers.begin(); it2 != headers.end(); ++it2) {
-        out << it2->first << ": " << it2->second << "\r\n";
+    if (with_date && !has_date) {
+        out += "Date: ";
+        out += http_date_now();
+        out += "\r\n";
+    }
+    if (!has_server) out += kServer;
+    if (!has_nosniff) out += kNosniff;
+    for (auto& [k, v] : headers) {
+        out += k;
+        out += ": ";
+        out += v;
+        out += "\r\n";
+    }
+    out += "\r\n";
+}
+
+std::string Response::to_string() const {
+    std::string out;
+    if (!file) out.reserve(body.size() + 256);
+    serialize_head(out);
+    if (stream) {
+        std::string piece;
+        bool more = true;
+        while (more) {
+            piece.clear();
+            more = stream(piece);
+            if (streams_chunked()) append_chunk(out, piece, !more);
+            else out += piece;
+        }
+    } else if (!file) {
+        out += body;
+    }
+    return out;
+}
+
+std::string_view Request::param(std::string_view name) const {
+    for (std::size_t i = 0; i < params.count; ++i) {
+        if (params.items[i].name == name) return std::string_view(path).substr(params.items[i].off, params.items[i].len);
+    }
+    return {};
+}
+
+const std::string* find_header(const std::unordered_map<std::string, std::string>& headers, const std::string& name) {
+    auto it = headers.find(name);
+    if (it != headers.end()) return &it->second;
+    for (auto& [k, v] : headers) {
+        if (k.size() != name.size()) continue;
+        bool eq = true;
+        for (size_t i = 0; i < k.size() && eq; ++i) {
+            eq = std::tolower(static_cast<unsigned char>(k[i])) == std::tolower(static_cast<unsigned char>(name[i]));
+        }
+        if (eq) return &v;
     }
-    out << "\r\n";
-    out << body;
-    return out.str();
+    return nullptr;
 }
 
 std::string url_decode(const std::string& s) {
     std::string out;
     out.reserve(s.size());
     for (size_t i = 0; i < s.size(); ++i) {
-        if (s[i] == '%' && i + 2 < s.size()) {
+        if (s[i] == '%' && i + 2 < s.size() && std::isxdigit(static_cast<unsigned char>(s[i+1])) && std::isxdigit(static_cast<unsigned char>(s[i+2]))) {
             auto hex = s.substr(i + 1, 2);
             int val = std::stoi(hex, nullptr, 16);
             out.push_back(static_cast<char>(val));
@@ -1,10 +1,28 @@
 #pragma once
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
 namespace web {
 
+struct OpenFile;
+
+struct RouteParams {
+    static constexpr std::size_t kMax = 8;
+    struct Param {
+        std::string_view name;
+        std::uint32_t off;
+        std::uint32_t len;
+    };
+    std::array<Param, kMax> items;
+    std::size_t count = 0;
+};
+
 struct Request {
     std::string method;
     std::string path;
@@ -12,18 +30,41 @@ struct Request {
     std::unordered_map<std::string, std::string> headers;
     std::string body;
     std::string raw_target;
+    std::string version;
+    RouteParams params;
+    std::string_view param(std::string_view name) const;
 };
 
+// Pull-based response body. The connection calls it only once everything it
+// returned before has reached the socket; it appends the next piece to out
+// and returns false after the last piece. Without a Content-Length header the
+// body goes out chunked (or, for HTTP/1.0, delimited by closing).
+using BodyProducer = std::function<bool(std::string& out)>;
+
 struct Response {
     int status = 200;
     std::unordered_map<std::string, std::string> headers;
     std::string body;
     std::string reason;
+    std::shared_ptr<const OpenFile> file;
+    BodyProducer stream;
+    bool chunked = true;
+    bool streams_chunked() const;
+    std::uint64_t content_length() const;
+    // with_date = false leaves out the Date header, for responses serialized
+    // once and sent many times; the sender adds a current one.
+    void serialize_head(std::string& out, bool with_date = true) const;
     std::string to_string() const;
 };
 
 Request parse_request(const std::string& data);
+void tick_http_date();
+std::string_view http_date_now();
 std::string url_decode(const std::string& s);
+std::unordered_map<std::string, std::string> parse_query(const std::string& q);
+// Appends data in chunked framing, plus the terminating chunk when last.
+void append_chunk(std::string& out, std::string_view data, bool last);
+const std::string* find_header(const std::unordered_map<std::string, std::string>& headers, const std::string& name);
 
 } // namespace web
 
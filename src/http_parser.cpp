@@ -0,0 +1,196 @@
+#include "http_parser.hpp"
+#include "scan.hpp"
+#include <algorithm>
+
+namespace web {
+
+static inline bool is_tchar(unsigned char c) {
+    return is_token_char(c);
+}
+
+static bool iequals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        unsigned char x = static_cast<unsigned char>(a[i]);
+        unsigned char y = static_cast<unsigned char>(b[i]);
+        if (x >= 'A' && x <= 'Z') x = static_cast<unsigned char>(x + 32);
+        if (y >= 'A' && y <= 'Z') y = static_cast<unsigned char>(y + 32);
+        if (x != y) return false;
+    }
+    return true;
+}
+
+std::size_t RequestView::find_header(std::string_view name, std::size_t from) const {
+    for (std::size_t i = from; i < header_count; ++i) {
+        if (iequals(headers[i].name, name)) return i;
+    }
+    return header_count;
+}
+
+std::string_view RequestView::header(std::string_view name) const {
+    std::size_t i = find_header(name);
+    return i < header_count ? headers[i].value : std::string_view{};
+}
+
+bool RequestView::has_header(std::string_view name) const {
+    return find_header(name) < header_count;
+}
+
+void RequestParser::reset() {
+    state_ = State::Method;
+    pos_ = 0;
+    mark_ = 0;
+    value_mark_ = 0;
+    header_count_ = 0;
+    view_ = RequestView{};
+}
+
+static bool valid_version(std::string_view v) {
+    return v.size() == 8 && v.substr(0, 5) == "HTTP/" && v[5] >= '0' && v[5] <= '9' && v[6] == '.' && v[7] >= '0' && v[7] <= '9';
+}
+
+ParseStatus RequestParser::parse(std::string_view buf, std::size_t max_head) {
+    const char* d = buf.data();
+    // Bytes past the limit are never scanned; running out of them before
+    // the end of the head means the head is too large.
+    const std::size_t n = (std::min)(buf.size(), max_head);
+    std::size_t i = pos_;
+    auto span = [](std::size_t b, std::size_t e) {
+        return Span{static_cast<std::uint32_t>(b), static_cast<std::uint32_t>(e - b)};
+    };
+    if (n > UINT32_MAX) return ParseStatus::Error;
+    while (i < n) {
+        unsigned char c = static_cast<unsigned char>(d[i]);
+        switch (state_) {
+            case State::Method:
+                if (i == mark_ && (c == '\r' || c == '\n')) {
+                    mark_ = ++i;
+                    continue;
+                }
+                if (c == ' ') {
+                    if (i == mark_) return ParseStatus::Error;
+                    method_ = span(mark_, i);
+                    mark_ = ++i;
+                    state_ = State::Target;
+                    continue;
+                }
+                if (!is_tchar(c)) return ParseStatus::Error;
+                i = scan_token(d, i + 1, n);
+                continue;
+            case State::Target:
+                i = scan_target(d, i, n);
+                if (i == n) continue;
+                if (d[i] != ' ' || i == mark_) return ParseStatus::Error;
+                target_ = span(mark_, i);
+                mark_ = ++i;
+                state_ = State::Version;
+                continue;
+            case State::Version:
+                if (c == '\r' || c == '\n') {
+                    version_ = span(mark_, i);
+                    if (!valid_version(std::string_view(d + mark_, i - mark_))) return ParseStatus::Error;
+                    state_ = c == '\r' ? State::RequestLineLF : State::HeaderStart;
+                    ++i;
+                    mark_ = i;
+                    continue;
+                }
+                if (i - mark_ >= 8) return ParseStatus::Error;
+                ++i;
+                continue;
+            case State::RequestLineLF:
+            case State::HeaderLF:
+                if (c != '\n') return ParseStatus::Error;
+                mark_ = ++i;
+                state_ = State::HeaderStart;
+                continue;
+            case State::HeaderStart:
+                if (c == '\r') {
+                    state_ = State::HeadEndLF;
+                    ++i;
+                    continue;
+                }
+                if (c == '\n') {
+                    ++i;
+                    state_ = State::Done;
+                    break;
+                }
+                if (!is_tchar(c)) return ParseStatus::Error;
+                if (header_count_ == RequestView::kMaxHeaders) return ParseStatus::TooLarge;
+                mark_ = i++;
+                state_ = State::HeaderName;
+                continue;
+            case State::HeaderName:
+                i = scan_token(d, i, n);
+                if (i == n) continue;
+                if (d[i] != ':') return ParseStatus::Error;
+                headers_[header_count_].first = span(mark_, i);
+                ++i;
+                state_ = State::HeaderValueStart;
+                continue;
+            case State::HeaderValueStart:
+                if (c == ' ' || c == '\t') {
+                    ++i;
+                    continue;
+                }
+                value_mark_ = i;
+                state_ = State::HeaderValue;
+                continue;
+            case State::HeaderValue: {
+                i = scan_value(d, i, n);
+                if (i == n) continue;
+                char e_c = d[i];
+                if (e_c != '\r' && e_c != '\n') return ParseStatus::Error;
+                std::size_t e = i;
+                while (e > value_mark_ && (d[e-1] == ' ' || d[e-1] == '\t')) --e;
+                headers_[header_count_++].second = span(value_mark_, e);
+                state_ = e_c == '\r' ? State::HeaderLF : State::HeaderStart;
+                ++i;
+                mark_ = i;
+                continue;
+            }
+            case State::HeadEndLF:
+                if (c != '\n') return ParseStatus::Error;
+                ++i;
+                state_ = State::Done;
+                break;
+            case State::Done:
+                break;
+        }
+        if (state_ == State::Done) break;
+    }
+    pos_ = i;
+    if (state_ != State::Done) return i >= max_head ? ParseStatus::TooLarge : ParseStatus::NeedMore;
+    build_view(buf);
+    return ParseStatus::Complete;
+}
+
+void RequestParser::build_view(std::string_view buf) {
+    auto at = [&](Span s) { return buf.substr(s.off, s.len); };
+    view_.method = at(method_);
+    view_.target = at(target_);
+    view_.version = at(version_);
+    auto q = view_.target.find('?');
+    view_.path = view_.target.substr(0, q);
+    view_.query = q == std::string_view::npos ? std::string_view{} : view_.target.substr(q + 1);
+    view_.header_count = header_count_;
+    for (std::size_t k = 0; k < header_count_; ++k) {
+        view_.headers[k] = HeaderView{at(headers_[k].first), at(headers_[k].second)};
+    }
+    view_.head_length = pos_;
+}
+
+Request to_request(const RequestView& v) {
+    Request r;
+    r.method.assign(v.method);
+    r.raw_target.assign(v.target);
+    r.path.assign(v.path);
+    r.version.assign(v.version);
+    if (!v.query.empty()) r.query = parse_query(std::string(v.query));
+    r.headers.reserve(v.header_count);
+    for (std::size_t k = 0; k < v.header_count; ++k) {
+        r.headers[std::string(v.headers[k].name)] = std::string(v.headers[k].value);
+    }
+    return r;
+}
+
+}
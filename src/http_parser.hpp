@@ -0,0 +1,65 @@
+#pragma once
+#include "http.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace web {
+
+struct HeaderView {
+    std::string_view name;
+    std::string_view value;
+};
+
+struct RequestView {
+    static constexpr std::size_t kMaxHeaders = 64;
+    std::string_view method;
+    std::string_view target;
+    std::string_view path;
+    std::string_view query;
+    std::string_view version;
+    std::array<HeaderView, kMaxHeaders> headers{};
+    std::size_t header_count = 0;
+    std::size_t head_length = 0;
+    std::string_view header(std::string_view name) const;
+    bool has_header(std::string_view name) const;
+    // Index of the next field named `name` at or after `from`, or
+    // header_count; walks repeated fields such as duplicate Content-Length.
+    std::size_t find_header(std::string_view name, std::size_t from = 0) const;
+};
+
+enum class ParseStatus { Complete, NeedMore, Error, TooLarge };
+
+// Resumable request-head parser. Call parse() with the connection's read
+// buffer each time more bytes arrive; the buffer must start at the same
+// request each time, but may be reallocated between calls since progress
+// is kept as offsets. Views in request() point into the buffer last passed
+// to parse() and are valid until it is modified. A head longer than
+// max_head bytes, or with more than kMaxHeaders fields, is TooLarge.
+class RequestParser {
+public:
+    ParseStatus parse(std::string_view buf, std::size_t max_head = SIZE_MAX);
+    const RequestView& request() const { return view_; }
+    void reset();
+private:
+    enum class State : std::uint8_t {
+        Method, Target, Version, RequestLineLF,
+        HeaderStart, HeaderName, HeaderValueStart, HeaderValue, HeaderLF,
+        HeadEndLF, Done
+    };
+    struct Span { std::uint32_t off, len; };
+    State state_ = State::Method;
+    std::size_t pos_ = 0;
+    std::size_t mark_ = 0;
+    std::size_t value_mark_ = 0;
+    Span method_{}, target_{}, version_{};
+    std::array<std::pair<Span, Span>, RequestView::kMaxHeaders> headers_{};
+    std::size_t header_count_ = 0;
+    RequestView view_;
+    void build_view(std::string_view buf);
+};
+
+Request to_request(const RequestView& v);
+
+}
@@ -1,7 +1,6 @@
 #include "logger.hpp"
 #include <chrono>
-#include <iomanip>
-#include <sstream>
+#include <cstdio>
 #include <ctime>
 #if defined(_WIN32)
 #include <windows.h>
@@ -14,6 +13,10 @@ Logger& Logger::instance() {
     return inst;
 }
 
+Logger::~Logger() {
+    stop_async();
+}
+
 void Logger::set_level(LogLevel lvl) {
     level_ = lvl;
 }
@@ -32,6 +35,12 @@ void Logger::set_file(const std::string& path, std::size_t max_bytes) {
     max_bytes_ = max_bytes;
     if (file_.is_open()) file_.close();
     file_.open(file_path_, std::ios::app | std::ios::out);
+    file_size_ = 0;
+    if (file_.is_open()) {
+        file_.seekp(0, std::ios::end);
+        auto pos = file_.tellp();
+        if (pos > 0) file_size_ = static_cast<std::size_t>(pos);
+    }
 }
 
 const char* Logger::level_name(LogLevel lvl) {
@@ -45,27 +54,39 @@ const char* Logger::level_name(LogLevel lvl) {
     }
 }
 
-std::string Logger::timestamp() {
+std::string Logger::format(LogLevel lvl, const std::string& msg) {
     using namespace std::chrono;
+    struct Prefix {
+        std::int64_t second = -1;
+        char buf[32];
+    };
+    thread_local Prefix p;
     auto now = system_clock::now();
-    auto tt = system_clock::to_time_t(now);
-    auto ms = duration_cast<milliseconds>(now.time_since_epoch()) % 1000;
-    std::tm tm{};
+    auto ms = duration_cast<milliseconds>(now.time_since_epoch()).count();
+    std::int64_t sec = ms / 1000;
+    if (sec != p.second) {
+        std::time_t tt = static_cast<std::time_t>(sec);
+        std::tm tm{};
 #if defined(_WIN32)
-    localtime_s(&tm, &tt);
+        localtime_s(&tm, &tt);
 #else
-    localtime_r(&tt, &tm);
+        localtime_r(&tt, &tm);
 #endif
-    std::ostringstream ss;
-    ss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S") << "." << std::setw(3) << std::setfill('0') << ms.count();
-    return ss.str();
+        std::strftime(p.buf, sizeof(p.buf), "%Y-%m-%d %H:%M:%S", &tm);
+        p.second = sec;
+    }
+    char head[64];
+    int n = std::snprintf(head, sizeof(head), "%s.%03d [%s] ", p.buf, static_cast<int>(ms % 1000), level_name(lvl));
+    std::string line;
+    line.reserve(static_cast<std::size_t>(n) + msg.size());
+    line.append(head, static_cast<std::size_t>(n));
+    line += msg;
+    return line;
 }
 
 void Logger::rotate_if_needed(std::size_t append_len) {
     if (!file_.is_open() || max_bytes_ == 0) return;
-    file_.seekp(0, std::ios::end);
-    auto size = static_cast<std::size_t>(file_.tellp());
-    if (size + append_len < max_bytes_) return;
+    if (file_size_ + append_len < max_bytes_) return;
     file_.close();
     std::string rotated = file_path_ + ".1";
 #if defined(_WIN32)
@@ -76,7 +97,21 @@ void Logger::rotate_if_needed(std::size_t append_len) {
     std::rename(file_path_.c_str(), rotated.c_str());
 #endif
     file_.open(file_path_, std::ios::out | std::ios::trunc);
+    file_size_ = 0;
+}
+
+#if !defined(_WIN32)
+static const char* console_color(LogLevel lvl) {
+    switch (lvl) {
+        case LogLevel::Trace: return "\033[90m";
+        case LogLevel::Debug: return "\033[37m";
+        case LogLevel::Info:  return "\033[0m";
+        case LogLevel::Warn:  return "\033[33m";
+        case LogLevel::Error: return "\033[31m";
+        default: return "\033[0m";
+    }
 }
+#endif
 
 void Logger::write_line(const std::string& line, LogLevel lvl) {
     std::lock_guard<std::mutex> lk(mtx_);
@@ -84,6 +119,7 @@ void Logger::write_line(const std::string& line, LogLevel lvl) {
     if (file_.is_open()) {
         file_ << line << "\n";
         file_.flush();
+        file_size_ += line.size() + 1;
     }
     if (console_) {
 #if defined(_WIN32)
@@ -102,25 +138,196 @@ void Logger::write_line(const std::string& line, LogLevel lvl) {
         printf("%s\n", line.c_str());
         SetConsoleTextAttribute(h, info.wAttributes);
 #else
-        const char* pre = "";
-        const char* post = "\033[0m";
+        fprintf(stdout, "%s%s\033[0m\n", console_color(lvl), line.c_str());
+#endif
+    }
+}
+
+void Logger::write_batch(std::vector<std::pair<LogLevel, std::string>>& batch) {
+    std::string out;
+    for (auto& [lvl, line] : batch) out.append(line).push_back('\n');
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        rotate_if_needed(out.size());
+        if (file_.is_open()) {
+            file_.write(out.data(), static_cast<std::streamsize>(out.size()));
+            file_size_ += out.size();
+        }
+    }
+    if (!console_) return;
+#if defined(_WIN32)
+    for (auto& [lvl, line] : batch) {
+        HANDLE h = GetStdHandle(STD_OUTPUT_HANDLE);
+        WORD color = 7;
         switch (lvl) {
-            case LogLevel::Trace: pre = "\033[90m"; break;
-            case LogLevel::Debug: pre = "\033[37m"; break;
-            case LogLevel::Info:  pre = "\033[0m"; break;
-            case LogLevel::Warn:  pre = "\033[33m"; break;
-            case LogLevel::Error: pre = "\033[31m"; break;
+            case LogLevel::Trace: color = 8; break;
+            case LogLevel::Warn:  color = 6; break;
+            case LogLevel::Error: color = 12; break;
+            default: break;
         }
-        fprintf(stdout, "%s%s%s\n", pre, line.c_str(), post);
+        CONSOLE_SCREEN_BUFFER_INFO info{};
+        GetConsoleScreenBufferInfo(h, &info);
+        SetConsoleTextAttribute(h, color);
+        printf("%s\n", line.c_str());
+        SetConsoleTextAttribute(h, info.wAttributes);
+    }
+#else
+    out.clear();
+    for (auto& [lvl, line] : batch) {
+        out += console_color(lvl);
+        out += line;
+        out += "\033[0m\n";
+    }
+    fwrite(out.data(), 1, out.size(), stdout);
 #endif
+}
+
+bool Logger::enqueue(LogLevel lvl, std::string&& line) {
+    const std::uint64_t cap = mask_ + 1;
+    bool low = static_cast<int>(lvl) <= static_cast<int>(LogLevel::Info);
+    std::uint64_t pos = tail_.load(std::memory_order_relaxed);
+    for (;;) {
+        if (policy_ == LogOverflow::Sample && low) {
+            std::uint64_t used = pos - head_.load(std::memory_order_relaxed);
+            if (used >= cap - cap / 4 && sampled_.fetch_add(1, std::memory_order_relaxed) % sample_every_ != 0) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+        }
+        Slot& slot = ring_[pos & mask_];
+        std::uint64_t seq = slot.seq.load(std::memory_order_acquire);
+        auto diff = static_cast<std::int64_t>(seq - pos);
+        if (diff == 0) {
+            if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                slot.lvl = lvl;
+                slot.line = std::move(line);
+                slot.seq.store(pos + 1, std::memory_order_release);
+                break;
+            }
+        } else if (diff < 0) {
+            if (policy_ != LogOverflow::Block || !async_.load(std::memory_order_relaxed)) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            std::uint64_t h = head_.load(std::memory_order_acquire);
+            if (pos - h >= cap) head_.wait(h, std::memory_order_acquire);
+            pos = tail_.load(std::memory_order_relaxed);
+        } else {
+            pos = tail_.load(std::memory_order_relaxed);
+        }
     }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_relaxed)) {
+        wake_.fetch_add(1, std::memory_order_relaxed);
+        wake_.notify_one();
+    }
+    return true;
+}
+
+void Logger::writer_loop() {
+    std::vector<std::pair<LogLevel, std::string>> batch;
+    batch.reserve(512);
+    bool dirty = false;
+    for (;;) {
+        std::uint64_t pos = head_.load(std::memory_order_relaxed);
+        while (batch.size() < 512) {
+            Slot& slot = ring_[pos & mask_];
+            if (slot.seq.load(std::memory_order_acquire) != pos + 1) break;
+            batch.emplace_back(slot.lvl, std::move(slot.line));
+            slot.line.clear();
+            slot.seq.store(pos + mask_ + 1, std::memory_order_release);
+            ++pos;
+        }
+        if (!batch.empty()) {
+            head_.store(pos, std::memory_order_release);
+            head_.notify_all();
+            write_batch(batch);
+            written_.fetch_add(batch.size(), std::memory_order_release);
+            written_.notify_all();
+            batch.clear();
+            dirty = true;
+            continue;
+        }
+        if (dirty) {
+            {
+                std::lock_guard<std::mutex> lk(mtx_);
+                if (file_.is_open()) file_.flush();
+            }
+            if (console_) fflush(stdout);
+            dirty = false;
+        }
+        bool stopping = stopping_.load(std::memory_order_acquire);
+        if (stopping && tail_.load(std::memory_order_acquire) == pos) break;
+        std::uint32_t w = wake_.load(std::memory_order_relaxed);
+        sleeping_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        Slot& next = ring_[pos & mask_];
+        if (stopping || next.seq.load(std::memory_order_acquire) == pos + 1) {
+            sleeping_.store(false, std::memory_order_relaxed);
+            if (stopping) std::this_thread::yield();
+            continue;
+        }
+        wake_.wait(w, std::memory_order_relaxed);
+        sleeping_.store(false, std::memory_order_relaxed);
+    }
+}
+
+void Logger::start_async(std::size_t capacity, LogOverflow policy, unsigned sample_every) {
+    std::lock_guard<std::mutex> lk(async_mtx_);
+    if (writer_.joinable()) return;
+    std::uint64_t cap = 64;
+    while (cap < capacity) cap <<= 1;
+    ring_ = std::make_unique<Slot[]>(cap);
+    for (std::uint64_t i = 0; i < cap; ++i) ring_[i].seq.store(i, std::memory_order_relaxed);
+    mask_ = cap - 1;
+    policy_ = policy;
+    sample_every_ = sample_every == 0 ? 1 : sample_every;
+    tail_.store(0);
+    head_.store(0);
+    written_.store(0);
+    stopping_.store(false);
+    writer_ = std::thread([this] { writer_loop(); });
+    async_.store(true, std::memory_order_release);
+}
+
+void Logger::stop_async() {
+    std::lock_guard<std::mutex> lk(async_mtx_);
+    if (!writer_.joinable()) return;
+    async_.store(false, std::memory_order_release);
+    head_.notify_all();
+    stopping_.store(true, std::memory_order_release);
+    wake_.fetch_add(1, std::memory_order_relaxed);
+    wake_.notify_one();
+    writer_.join();
+    written_.notify_all();
+}
+
+void Logger::flush() {
+    if (async_.load(std::memory_order_acquire)) {
+        std::uint64_t target = tail_.load(std::memory_order_acquire);
+        std::uint64_t done = written_.load(std::memory_order_acquire);
+        while (done < target && async_.load(std::memory_order_acquire)) {
+            written_.wait(done, std::memory_order_acquire);
+            done = written_.load(std::memory_order_acquire);
+        }
+    }
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (file_.is_open()) file_.flush();
+    fflush(stdout);
+}
+
+std::uint64_t Logger::dropped() const {
+    return dropped_.load(std::memory_order_relaxed);
 }
 
 void Logger::log(LogLevel lvl, const std::string& msg) {
     if (static_cast<int>(lvl) < static_cast<int>(level_.load())) return;
-    std::ostringstream ss;
-    ss << timestamp() << " [" << level_name(lvl) << "] " << msg;
-    write_line(ss.str(), lvl);
+    auto line = format(lvl, msg);
+    if (async_.load(std::memory_order_acquire)) {
+        enqueue(lvl, std::move(line));
+        return;
+    }
+    write_line(line, lvl);
 }
 
 }
@@ -3,32 +3,71 @@
 #include <mutex>
 #include <fstream>
 #include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstdint>
 
 namespace web {
 
 enum class LogLevel { Trace, Debug, Info, Warn, Error };
 
+// What async producers do when the ring is full. Sample keeps admitting one in
+// every N Trace/Debug/Info records once the ring is three quarters full and
+// drops the rest; Warn and Error are only dropped when the ring is full.
+enum class LogOverflow { Drop, Block, Sample };
+
 class Logger {
 public:
     static Logger& instance();
+    ~Logger();
     void set_level(LogLevel lvl);
     LogLevel get_level() const;
     const char* level_name(LogLevel lvl);
     void enable_console(bool enabled);
     void set_file(const std::string& path, std::size_t max_bytes);
     void log(LogLevel lvl, const std::string& msg);
+    void start_async(std::size_t capacity = 8192, LogOverflow policy = LogOverflow::Drop, unsigned sample_every = 16);
+    void stop_async();
+    void flush();
+    std::uint64_t dropped() const;
 private:
+    struct Slot {
+        std::atomic<std::uint64_t> seq{0};
+        LogLevel lvl = LogLevel::Info;
+        std::string line;
+    };
     Logger() = default;
     std::mutex mtx_;
     std::ofstream file_;
     std::string file_path_;
     std::size_t max_bytes_{0};
+    std::size_t file_size_{0};
     std::atomic<LogLevel> level_{LogLevel::Info};
     std::atomic<bool> console_{true};
+
+    std::mutex async_mtx_;
+    std::unique_ptr<Slot[]> ring_;
+    std::uint64_t mask_{0};
+    LogOverflow policy_{LogOverflow::Drop};
+    unsigned sample_every_{16};
+    std::atomic<bool> async_{false};
+    std::atomic<bool> stopping_{false};
+    std::atomic<bool> sleeping_{false};
+    std::atomic<std::uint64_t> tail_{0};
+    std::atomic<std::uint64_t> head_{0};
+    std::atomic<std::uint64_t> written_{0};
+    std::atomic<std::uint32_t> wake_{0};
+    std::atomic<std::uint64_t> dropped_{0};
+    std::atomic<std::uint64_t> sampled_{0};
+    std::thread writer_;
+
     void write_line(const std::string& line, LogLevel lvl);
-    std::string timestamp();
+    void write_batch(std::vector<std::pair<LogLevel, std::string>>& batch);
+    std::string format(LogLevel lvl, const std::string& msg);
     void rotate_if_needed(std::size_t append_len);
+    bool enqueue(LogLevel lvl, std::string&& line);
+    void writer_loop();
 };
 
 }
-
@@ -5,13 +5,136 @@
 #include "logger.hpp"
 #include "module.hpp"
 #include "modules/portfolio.hpp"
+#include "async_runtime.hpp"
+#include "prefork.hpp"
+#include "socket_util.hpp"
+#include "upgrade.hpp"
+#include <algorithm>
+#include <charconv>
 #include <iostream>
 #include <thread>
 #include <chrono>
+#include <cstring>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+// Listener handoff settings: the socket this process serves for its own
+// successor and the control connection to its predecessor.
+struct UpgradeOptions {
+    std::string socket_path;
+    long long control = -1;
+};
+
+static volatile std::sig_atomic_t stop_signal = 0;
+
+// Caps on the demo routes' query parameters, so a client cannot make them
+// produce unbounded output or hold a connection open indefinitely.
+static constexpr std::uint64_t kMaxCount = 100000;
+static constexpr unsigned kMaxDelayMs = 2000;
+
+static web::Response bad_request(const std::string& why) {
+    web::Response resp;
+    resp.status = 400;
+    resp.body = why;
+    resp.headers["Content-Type"] = "text/plain; charset=utf-8";
+    return resp;
+}
+
+static void on_stop_signal(int sig) {
+    stop_signal = sig;
+}
+
+static int run_server(web::ServerConfig cfg, web::LogOverflow log_policy, UpgradeOptions upgrade);
+
+int main(int argc, char** argv) {
+    web::ServerConfig cfg;
+    web::LogOverflow log_policy = web::LogOverflow::Drop;
+    unsigned workers = 0;
+    UpgradeOptions upgrade;
+    std::string upgrade_from;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--backend") == 0 && i + 1 < argc) {
+            std::string b = argv[++i];
+            if (b == "epoll") cfg.backend = web::Backend::Epoll;
+            else if (b == "threads") cfg.backend = web::Backend::Threads;
+            else if (b == "uring") cfg.backend = web::Backend::Uring;
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            cfg.threads = static_cast<unsigned>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--reuseport") == 0) {
+            cfg.reuse_port = true;
+            cfg.pin_threads = true;
+        } else if (std::strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            workers = static_cast<unsigned>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--queue") == 0 && i + 1 < argc) {
+            cfg.queue_capacity = static_cast<std::size_t>(std::atol(argv[++i]));
+        } else if (std::strcmp(argv[i], "--overload") == 0 && i + 1 < argc) {
+            std::string o = argv[++i];
+            if (o == "reject") cfg.overload = web::Overload::Reject503;
+            else if (o == "pause") cfg.overload = web::Overload::PauseAccept;
+            else if (o == "drop-oldest") cfg.overload = web::Overload::DropOldest;
+        } else if (std::strcmp(argv[i], "--max-body") == 0 && i + 1 < argc) {
+            cfg.max_body_size = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--header-timeout") == 0 && i + 1 < argc) {
+            cfg.header_timeout = std::chrono::milliseconds(std::atol(argv[++i]));
+        } else if (std::strcmp(argv[i], "--body-timeout") == 0 && i + 1 < argc) {
+            cfg.body_timeout = std::chrono::milliseconds(std::atol(argv[++i]));
+        } else if (std::strcmp(argv[i], "--idle-timeout") == 0 && i + 1 < argc) {
+            cfg.idle_timeout = std::chrono::milliseconds(std::atol(argv[++i]));
+        } else if (std::strcmp(argv[i], "--write-timeout") == 0 && i + 1 < argc) {
+            cfg.write_timeout = std::chrono::milliseconds(std::atol(argv[++i]));
+        } else if (std::strcmp(argv[i], "--upgrade-socket") == 0 && i + 1 < argc) {
+            upgrade.socket_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--upgrade-from") == 0 && i + 1 < argc) {
+            upgrade_from = argv[++i];
+        } else if (std::strcmp(argv[i], "--drain-timeout") == 0 && i + 1 < argc) {
+            cfg.drain_timeout = std::chrono::milliseconds(std::atol(argv[++i]));
+        } else if (std::strcmp(argv[i], "--log-overflow") == 0 && i + 1 < argc) {
+            std::string p = argv[++i];
+            if (p == "block") log_policy = web::LogOverflow::Block;
+            else if (p == "sample") log_policy = web::LogOverflow::Sample;
+            else if (p == "drop") log_policy = web::LogOverflow::Drop;
+        }
+    }
 
-int main() {
     web::Logger::instance().enable_console(true);
     web::Logger::instance().set_level(web::LogLevel::Info);
+    if (workers > 0 && (!upgrade.socket_path.empty() || !upgrade_from.empty())) {
+        std::cerr << "Listener handoff is not supported in prefork mode, ignoring --upgrade-socket/--upgrade-from\n";
+        upgrade = UpgradeOptions{};
+        upgrade_from.clear();
+    }
+    if (!upgrade.socket_path.empty() && cfg.reuse_port) {
+        std::cerr << "Only one listen socket can be handed off, disabling --reuseport\n";
+        cfg.reuse_port = false;
+    }
+    if (!upgrade_from.empty()) {
+        if (!web::init_platform()) return 1;
+        cfg.listen_fd = web::receive_listener(upgrade_from, upgrade.control);
+        if (cfg.listen_fd < 0) {
+            std::cerr << "Failed to take over the listen socket from " << upgrade_from << "\n";
+            return 1;
+        }
+    }
+    if (workers > 0) {
+        if (!web::init_platform()) return 1;
+        cfg.listen_fd = web::open_listener("127.0.0.1", 8080);
+        if (cfg.listen_fd < 0) {
+            std::cerr << "Failed to listen on 127.0.0.1:8080\n";
+            return 1;
+        }
+        if (cfg.threads == 0) cfg.threads = (std::max)(1u, std::thread::hardware_concurrency() / workers);
+        int rc = web::run_prefork(workers, [&](unsigned) { return run_server(cfg, log_policy, upgrade); });
+        if (rc >= 0) return rc;
+        std::cerr << "Prefork mode is unavailable on this platform, running a single process\n";
+    }
+    return run_server(cfg, log_policy, upgrade);
+}
+
+static int run_server(web::ServerConfig cfg, web::LogOverflow log_policy, UpgradeOptions upgrade) {
+    web::Logger::instance().start_async(8192, log_policy);
     web::Router router;
     router.set_static_dir(STATIC_DIR);
     router.set_template_dir(TEMPLATE_DIR);
@@ -39,16 +162,77 @@ int main() {
         return resp;
     });
 
-    router.add("GET", "/assets/main.css", [](const web::Request& req) {
-        auto path = web::join_paths(STYLES_DIR, "main.ccss");
-        auto src = web::read_file(path);
+    router.add_async("GET", "/hello/:name", [](const web::Request& req) -> web::Task<web::Response> {
+        unsigned delay = 0;
+        auto it = req.query.find("delay");
+        if (it != req.query.end()) {
+            const std::string& v = it->second;
+            auto r = std::from_chars(v.data(), v.data() + v.size(), delay);
+            if (v.empty() || r.ec != std::errc() || r.ptr != v.data() + v.size() || delay > kMaxDelayMs) {
+                co_return bad_request("delay must be a number of milliseconds from 0 to " + std::to_string(kMaxDelayMs));
+            }
+        }
+        if (delay > 0) co_await web::sleep_for(std::chrono::milliseconds(delay));
         web::Response resp;
-        if (!src) {
-            resp.status = 404;
-            resp.body = "Not Found";
+        resp.status = 200;
+        resp.body = "Hello, " + std::string(req.param("name"));
+        resp.headers["Content-Type"] = "text/plain; charset=utf-8";
+        co_return resp;
+    });
+
+    // Streaming routes skip the buffered max_body_size check, so the reader
+    // enforces it and answers 413 once the upload goes past it.
+    struct UploadCounter : web::BodyReader {
+        std::uint64_t limit = 0;
+        std::uint64_t bytes = 0;
+        bool read(std::string_view chunk) override {
+            bytes += chunk.size();
+            return limit == 0 || bytes <= limit;
+        }
+        web::Response finish() override {
+            web::Response resp;
             resp.headers["Content-Type"] = "text/plain; charset=utf-8";
+            if (limit > 0 && bytes > limit) {
+                resp.status = 413;
+                resp.body = "Payload Too Large";
+                return resp;
+            }
+            resp.status = 200;
+            resp.body = "Received " + std::to_string(bytes) + " bytes";
             return resp;
         }
+    };
+    router.add_streaming("POST", "/upload", [limit = cfg.max_body_size](const web::Request&) {
+        auto counter = std::make_unique<UploadCounter>();
+        counter->limit = limit;
+        return counter;
+    });
+
+    router.add("GET", "/count", [](const web::Request& req) {
+        std::uint64_t n = 1000;
+        auto it = req.query.find("n");
+        if (it != req.query.end()) {
+            const std::string& v = it->second;
+            auto r = std::from_chars(v.data(), v.data() + v.size(), n);
+            if (v.empty() || r.ec != std::errc() || r.ptr != v.data() + v.size() || n > kMaxCount) {
+                return bad_request("n must be a number from 0 to " + std::to_string(kMaxCount));
+            }
+        }
+        web::Response resp;
+        resp.status = 200;
+        resp.headers["Content-Type"] = "text/plain; charset=utf-8";
+        resp.stream = [i = std::uint64_t{0}, n](std::string& out) mutable {
+            for (; i < n && out.size() < 16 * 1024; ++i) {
+                out += std::to_string(i);
+                out += '\n';
+            }
+            return i < n;
+        };
+        return resp;
+    });
+
+    web::CcssCache styles(STYLES_DIR);
+    router.add("GET", "/assets/main.css", [&styles](const web::Request& req) {
         std::unordered_map<std::string,std::string> overrides;
         for (auto it = req.query.begin(); it != req.query.end(); ++it) {
             const std::string& k = it->first;
@@ -58,23 +242,50 @@ int main() {
                 overrides[k.substr(4)] = it->second;
             }
         }
-        auto css = web::compile_ccss(*src, overrides.empty() ? nullptr : &overrides, STYLES_DIR);
-        web::Logger::instance().log(web::LogLevel::Info, "CCSS compiled main.ccss size " + std::to_string(css.size()));
+        auto css = styles.get("main.ccss", overrides.empty() ? nullptr : &overrides);
+        web::Response resp;
+        if (!css) {
+            resp.status = 404;
+            resp.body = "Not Found";
+            resp.headers["Content-Type"] = "text/plain; charset=utf-8";
+            return resp;
+        }
         resp.status = 200;
-        resp.body = css;
+        resp.body = *css;
         resp.headers["Content-Type"] = "text/css; charset=utf-8";
         return resp;
     });
 
+    router.add_warmup([&router, &styles] {
+        styles.get("main.ccss", nullptr);
+        router.render("index.html", web::Vars{});
+    });
+
     web::ModuleManager modules;
     modules.load_from_config(router);
+    router.warm_up();
 
-    web::Server server("127.0.0.1", 8080, router);
+    std::signal(SIGINT, on_stop_signal);
+    std::signal(SIGTERM, on_stop_signal);
+    web::Server server("127.0.0.1", 8080, router, cfg);
     server.start();
+    if (server.listener() < 0) return 1;
+    std::unique_ptr<web::UpgradeChannel> channel;
+    if (!upgrade.socket_path.empty()) channel = std::make_unique<web::UpgradeChannel>(upgrade.socket_path, server.listener());
+    if (upgrade.control >= 0 && !web::confirm_upgrade(upgrade.control)) {
+        web::Logger::instance().log(web::LogLevel::Warn, "Predecessor went away before the handoff was confirmed");
+    }
     std::cout << "Server running on http://127.0.0.1:8080/\n";
     std::cout.flush();
-    for (;;) {
-        std::this_thread::sleep_for(std::chrono::seconds(60));
+    auto stopping = [] { return stop_signal != 0; };
+    bool handed_off = channel && channel->ok() && channel->wait_for_successor(stopping);
+    while (!handed_off && !stopping()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
     }
+    channel.reset();
+    web::Logger::instance().log(web::LogLevel::Info, handed_off ? "Successor took over, draining" : "Stop signal received, draining");
+    server.shutdown();
+    web::Logger::instance().stop_async();
+    web::Logger::instance().flush();
     return 0;
 }
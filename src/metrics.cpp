@@ -0,0 +1,306 @@
+#include "metrics.hpp"
+#include "logger.hpp"
+#include <bit>
+#include <charconv>
+#include <cstdio>
+#include <new>
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#endif
+
+namespace web {
+
+template <typename T>
+static void bump(std::atomic<T>& c, T by = 1) {
+    c.store(c.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+}
+
+Metrics& Metrics::instance() {
+    static Metrics inst;
+    return inst;
+}
+
+Metrics::Metrics() : started_(std::chrono::steady_clock::now()) {}
+
+// Shared region layout: one claimed-shard count per worker, padded to a
+// cache line, then each worker's kShardsPerWorker shards. Shards are
+// constructed on first claim only, so a restarted worker keeps counting
+// where its predecessor stopped and untouched slices cost no memory.
+static std::size_t shared_header(unsigned workers) {
+    return (workers * sizeof(std::atomic<std::uint32_t>) + 63) / 64 * 64;
+}
+
+Metrics::Shard& Metrics::local() {
+    thread_local Shard* shard = nullptr;
+    if (!shard) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (shared_ && shared_used_ < kShardsPerWorker) {
+            unsigned slot = shared_used_++;
+            shard = &shared_[shared_worker_ * kShardsPerWorker + slot];
+            auto& claimed = shared_claimed_[shared_worker_];
+            if (claimed.load(std::memory_order_relaxed) <= slot) {
+                new (shard) Shard();
+                claimed.store(slot + 1, std::memory_order_release);
+            }
+        } else {
+            auto s = std::make_unique<Shard>();
+            shard = s.get();
+            shards_.push_back(std::move(s));
+        }
+    }
+    return *shard;
+}
+
+void* Metrics::create_shared(unsigned workers) {
+#if defined(_WIN32)
+    (void)workers;
+    return nullptr;
+#else
+    std::size_t bytes = shared_header(workers) + static_cast<std::size_t>(workers) * kShardsPerWorker * sizeof(Shard);
+    void* p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return nullptr;
+    auto* claimed = static_cast<std::atomic<std::uint32_t>*>(p);
+    for (unsigned w = 0; w < workers; ++w) new (&claimed[w]) std::atomic<std::uint32_t>(0);
+    return p;
+#endif
+}
+
+void Metrics::reset_shared_gauges(void* region, unsigned workers, unsigned worker) {
+    if (!region) return;
+    auto* claimed = static_cast<std::atomic<std::uint32_t>*>(region);
+    auto* shards = reinterpret_cast<Shard*>(static_cast<char*>(region) + shared_header(workers)) + static_cast<std::size_t>(worker) * kShardsPerWorker;
+    unsigned n = claimed[worker].load(std::memory_order_acquire);
+    for (unsigned i = 0; i < n; ++i) {
+        shards[i].connections.store(0, std::memory_order_relaxed);
+        shards[i].queued.store(0, std::memory_order_relaxed);
+    }
+}
+
+void Metrics::attach_shared(void* region, unsigned workers, unsigned worker) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    shared_claimed_ = static_cast<std::atomic<std::uint32_t>*>(region);
+    shared_ = reinterpret_cast<Shard*>(static_cast<char*>(region) + shared_header(workers));
+    shared_workers_ = workers;
+    shared_worker_ = worker;
+    shared_used_ = 0;
+}
+
+unsigned Metrics::bucket_for(std::uint64_t us) {
+    if (us < 4) return static_cast<unsigned>(us);
+    unsigned msb = static_cast<unsigned>(std::bit_width(us)) - 1;
+    unsigned b = 4 * (msb - 1) + static_cast<unsigned>((us >> (msb - 2)) & 3);
+    return b < kBuckets ? b : kBuckets - 1;
+}
+
+std::uint64_t Metrics::bucket_upper_us(unsigned bucket) {
+    if (bucket < 4) return bucket + 1;
+    unsigned msb = bucket / 4 + 1;
+    std::uint64_t sub = bucket % 4;
+    return (4 + sub + 1) << (msb - 2);
+}
+
+void Metrics::record_request(unsigned route, int status, std::uint64_t bytes_in, std::uint64_t bytes_out, std::chrono::nanoseconds latency) {
+    Shard& s = local();
+    if (route >= kMaxRoutes) route = kMaxRoutes - 1;
+    int cls = status / 100 - 1;
+    if (cls < 0 || cls > 4) cls = 4;
+    auto us = static_cast<std::uint64_t>(latency.count() < 0 ? 0 : latency.count() / 1000);
+    bump(s.requests[route][cls]);
+    bump(s.latency[route][bucket_for(us)]);
+    bump(s.latency_sum_us[route], us);
+    bump(s.bytes_in, bytes_in);
+    bump(s.bytes_out, bytes_out);
+}
+
+void Metrics::connection_opened() {
+    bump<std::int64_t>(local().connections, 1);
+}
+
+void Metrics::connection_closed() {
+    bump<std::int64_t>(local().connections, -1);
+}
+
+void Metrics::queue_pushed() {
+    bump<std::int64_t>(local().queued, 1);
+}
+
+void Metrics::queue_popped() {
+    bump<std::int64_t>(local().queued, -1);
+}
+
+void Metrics::record_queue_wait(std::chrono::nanoseconds wait) {
+    Shard& s = local();
+    auto us = static_cast<std::uint64_t>(wait.count() < 0 ? 0 : wait.count() / 1000);
+    bump(s.queue_wait[bucket_for(us)]);
+    bump(s.queue_wait_sum_us, us);
+}
+
+void Metrics::connection_shed() {
+    bump(local().shed);
+}
+
+void Metrics::connection_timed_out(unsigned phase) {
+    if (phase < 4) bump(local().timeouts[phase]);
+}
+
+static void append_num(std::string& out, std::uint64_t v) {
+    char buf[24];
+    auto r = std::to_chars(buf, buf + sizeof(buf), v);
+    out.append(buf, static_cast<std::size_t>(r.ptr - buf));
+}
+
+static void append_seconds(std::string& out, std::uint64_t us) {
+    char buf[32];
+    int n = std::snprintf(buf, sizeof(buf), "%llu.%06llu", static_cast<unsigned long long>(us / 1000000), static_cast<unsigned long long>(us % 1000000));
+    out.append(buf, static_cast<std::size_t>(n));
+}
+
+static void append_label(std::string& out, const std::string& v) {
+    for (char ch : v) {
+        if (ch == '\\' || ch == '"') out.push_back('\\');
+        if (ch == '\n') {
+            out += "\\n";
+            continue;
+        }
+        out.push_back(ch);
+    }
+}
+
+std::string Metrics::render_prometheus(const std::vector<std::string>& route_names) const {
+    static const char* kClasses[5] = {"1xx", "2xx", "3xx", "4xx", "5xx"};
+    struct RouteTotals {
+        std::uint64_t requests[5] = {};
+        std::uint64_t latency[kBuckets] = {};
+        std::uint64_t sum_us = 0;
+    };
+    std::vector<RouteTotals> routes(kMaxRoutes);
+    std::uint64_t bytes_in = 0, bytes_out = 0, shed = 0, wait_sum_us = 0;
+    std::uint64_t wait[kBuckets] = {};
+    std::uint64_t timeouts[4] = {};
+    std::int64_t connections = 0, queued = 0;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        auto add = [&](const Shard* s) {
+            for (unsigned r = 0; r < kMaxRoutes; ++r) {
+                for (unsigned c = 0; c < 5; ++c) routes[r].requests[c] += s->requests[r][c].load(std::memory_order_relaxed);
+                for (unsigned b = 0; b < kBuckets; ++b) routes[r].latency[b] += s->latency[r][b].load(std::memory_order_relaxed);
+                routes[r].sum_us += s->latency_sum_us[r].load(std::memory_order_relaxed);
+            }
+            bytes_in += s->bytes_in.load(std::memory_order_relaxed);
+            bytes_out += s->bytes_out.load(std::memory_order_relaxed);
+            connections += s->connections.load(std::memory_order_relaxed);
+            queued += s->queued.load(std::memory_order_relaxed);
+            shed += s->shed.load(std::memory_order_relaxed);
+            for (unsigned p = 0; p < 4; ++p) timeouts[p] += s->timeouts[p].load(std::memory_order_relaxed);
+            wait_sum_us += s->queue_wait_sum_us.load(std::memory_order_relaxed);
+            for (unsigned b = 0; b < kBuckets; ++b) wait[b] += s->queue_wait[b].load(std::memory_order_relaxed);
+        };
+        for (auto& s : shards_) add(s.get());
+        for (unsigned w = 0; shared_ && w < shared_workers_; ++w) {
+            unsigned n = shared_claimed_[w].load(std::memory_order_acquire);
+            for (unsigned i = 0; i < n; ++i) add(&shared_[w * kShardsPerWorker + i]);
+        }
+    }
+    auto name_of = [&](unsigned r) -> std::string {
+        if (r == kMaxRoutes - 1 && route_names.size() >= kMaxRoutes) return "other";
+        return r < route_names.size() ? route_names[r] : "route_" + std::to_string(r);
+    };
+
+    std::string out;
+    out.reserve(8192);
+    auto uptime = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - started_).count();
+    out += "# HELP web_uptime_seconds Seconds since the process started.\n# TYPE web_uptime_seconds gauge\nweb_uptime_seconds ";
+    append_num(out, static_cast<std::uint64_t>(uptime));
+    out += "\n# HELP web_requests_total Requests handled by route and status class.\n# TYPE web_requests_total counter\n";
+    for (unsigned r = 0; r < kMaxRoutes; ++r) {
+        for (unsigned c = 0; c < 5; ++c) {
+            if (routes[r].requests[c] == 0) continue;
+            out += "web_requests_total{route=\"";
+            append_label(out, name_of(r));
+            out += "\",code=\"";
+            out += kClasses[c];
+            out += "\"} ";
+            append_num(out, routes[r].requests[c]);
+            out += '\n';
+        }
+    }
+    out += "# HELP web_request_duration_seconds Time from parsed request to queued response.\n# TYPE web_request_duration_seconds histogram\n";
+    for (unsigned r = 0; r < kMaxRoutes; ++r) {
+        std::uint64_t count = 0;
+        for (auto c : routes[r].requests) count += c;
+        if (count == 0) continue;
+        unsigned last = 0;
+        for (unsigned b = 0; b < kBuckets; ++b) {
+            if (routes[r].latency[b] != 0) last = b;
+        }
+        std::string label = "web_request_duration_seconds_bucket{route=\"";
+        append_label(label, name_of(r));
+        label += "\",le=\"";
+        std::uint64_t cumulative = 0;
+        for (unsigned b = 0; b <= last; ++b) {
+            cumulative += routes[r].latency[b];
+            out += label;
+            append_seconds(out, bucket_upper_us(b));
+            out += "\"} ";
+            append_num(out, cumulative);
+            out += '\n';
+        }
+        out += label;
+        out += "+Inf\"} ";
+        append_num(out, count);
+        out += "\nweb_request_duration_seconds_sum{route=\"";
+        append_label(out, name_of(r));
+        out += "\"} ";
+        append_seconds(out, routes[r].sum_us);
+        out += "\nweb_request_duration_seconds_count{route=\"";
+        append_label(out, name_of(r));
+        out += "\"} ";
+        append_num(out, count);
+        out += '\n';
+    }
+    out += "# HELP web_received_bytes_total Request bytes received.\n# TYPE web_received_bytes_total counter\nweb_received_bytes_total ";
+    append_num(out, bytes_in);
+    out += "\n# HELP web_sent_bytes_total Response bytes queued for sending.\n# TYPE web_sent_bytes_total counter\nweb_sent_bytes_total ";
+    append_num(out, bytes_out);
+    out += "\n# HELP web_active_connections Open client connections.\n# TYPE web_active_connections gauge\nweb_active_connections ";
+    append_num(out, static_cast<std::uint64_t>(connections < 0 ? 0 : connections));
+    out += "\n# HELP web_queue_depth Accepted connections waiting for a worker.\n# TYPE web_queue_depth gauge\nweb_queue_depth ";
+    append_num(out, static_cast<std::uint64_t>(queued < 0 ? 0 : queued));
+    out += "\n# HELP web_shed_connections_total Connections answered with 503 because the work queue was full.\n# TYPE web_shed_connections_total counter\nweb_shed_connections_total ";
+    append_num(out, shed);
+    out += "\n# HELP web_connection_timeouts_total Connections closed for missing a deadline.\n# TYPE web_connection_timeouts_total counter";
+    static const char* const kPhases[4] = {"header", "body", "idle", "write"};
+    for (unsigned p = 0; p < 4; ++p) {
+        out += "\nweb_connection_timeouts_total{phase=\"";
+        out += kPhases[p];
+        out += "\"} ";
+        append_num(out, timeouts[p]);
+    }
+    out += "\n# HELP web_queue_wait_seconds Time accepted connections spent in the work queue.\n# TYPE web_queue_wait_seconds histogram\n";
+    std::uint64_t waited = 0;
+    unsigned last = 0;
+    for (unsigned b = 0; b < kBuckets; ++b) {
+        if (wait[b] != 0) last = b;
+    }
+    for (unsigned b = 0; b <= last; ++b) {
+        waited += wait[b];
+        out += "web_queue_wait_seconds_bucket{le=\"";
+        append_seconds(out, bucket_upper_us(b));
+        out += "\"} ";
+        append_num(out, waited);
+        out += '\n';
+    }
+    out += "web_queue_wait_seconds_bucket{le=\"+Inf\"} ";
+    append_num(out, waited);
+    out += "\nweb_queue_wait_seconds_sum ";
+    append_seconds(out, wait_sum_us);
+    out += "\nweb_queue_wait_seconds_count ";
+    append_num(out, waited);
+    out += "\n# HELP web_log_dropped_total Log records dropped by the async logger.\n# TYPE web_log_dropped_total counter\nweb_log_dropped_total ";
+    append_num(out, Logger::instance().dropped());
+    out += '\n';
+    return out;
+}
+
+}
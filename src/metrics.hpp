@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace web {
+
+// Process-wide counters. Each thread writes only to its own cache-line
+// aligned shard with relaxed stores; shards are summed when /metrics is
+// scraped. Latencies go into log-linear buckets (four per power of two,
+// microsecond resolution).
+class Metrics {
+public:
+    static constexpr unsigned kMaxRoutes = 128;
+    static constexpr unsigned kBuckets = 104;
+    static Metrics& instance();
+    void record_request(unsigned route, int status, std::uint64_t bytes_in, std::uint64_t bytes_out, std::chrono::nanoseconds latency);
+    void connection_opened();
+    void connection_closed();
+    void queue_pushed();
+    void queue_popped();
+    void record_queue_wait(std::chrono::nanoseconds wait);
+    void connection_shed();
+    // phase: 0 header, 1 body, 2 idle, 3 write.
+    void connection_timed_out(unsigned phase);
+    std::string render_prometheus(const std::vector<std::string>& route_names) const;
+    // Prefork mode: a MAP_SHARED region with kShardsPerWorker shards per
+    // worker process, created by the supervisor before forking. An attached
+    // worker takes its threads' shards from its own slice and every scrape
+    // sums the whole region, so any worker can answer for all of them.
+    static constexpr unsigned kShardsPerWorker = 32;
+    static void* create_shared(unsigned workers);
+    static void reset_shared_gauges(void* region, unsigned workers, unsigned worker);
+    void attach_shared(void* region, unsigned workers, unsigned worker);
+    static unsigned bucket_for(std::uint64_t us);
+    static std::uint64_t bucket_upper_us(unsigned bucket);
+private:
+    struct alignas(64) Shard {
+        std::atomic<std::uint64_t> requests[kMaxRoutes][5];
+        std::atomic<std::uint64_t> latency[kMaxRoutes][kBuckets];
+        std::atomic<std::uint64_t> latency_sum_us[kMaxRoutes];
+        std::atomic<std::uint64_t> bytes_in;
+        std::atomic<std::uint64_t> bytes_out;
+        std::atomic<std::uint64_t> queue_wait[kBuckets];
+        std::atomic<std::uint64_t> queue_wait_sum_us;
+        std::atomic<std::uint64_t> shed;
+        std::atomic<std::uint64_t> timeouts[4];
+        alignas(64) std::atomic<std::int64_t> connections;
+        std::atomic<std::int64_t> queued;
+    };
+    Metrics();
+    Shard& local();
+    mutable std::mutex mtx_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    Shard* shared_ = nullptr;
+    std::atomic<std::uint32_t>* shared_claimed_ = nullptr;
+    unsigned shared_workers_ = 0;
+    unsigned shared_worker_ = 0;
+    unsigned shared_used_ = 0;
+    std::chrono::steady_clock::time_point started_;
+};
+
+}
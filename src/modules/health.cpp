@@ -1,4 +1,5 @@
 #include "health.hpp"
+#include "metrics.hpp"
 
 namespace web {
 
@@ -14,11 +15,11 @@ void HealthModule::register_routes(Router& router) {
         r.body = "OK";
         return r;
     });
-    router.add("GET", "/metrics", [](const Request& req){
+    router.add("GET", "/metrics", [&router](const Request& req){
         Response r;
         r.status = 200;
-        r.headers["Content-Type"] = "text/plain; charset=utf-8";
-        r.body = "uptime_seconds=0\nrequests_total=0";
+        r.headers["Content-Type"] = "text/plain; version=0.0.4; charset=utf-8";
+        r.body = Metrics::instance().render_prometheus(router.route_names());
         return r;
     });
 }
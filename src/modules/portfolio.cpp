@@ -1,5 +1,6 @@
 #include "portfolio.hpp"
 #include "logger.hpp"
+#include <chrono>
 #include <sstream>
 
 namespace web {
@@ -85,49 +86,143 @@ static std::vector<Vars> parse_projects_json(const std::string& json) {
     return out;
 }
 
-std::vector<Vars> PortfolioModule::load_projects() {
+static std::int64_t steady_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::shared_ptr<const PortfolioModule::Snapshot> PortfolioModule::load_snapshot() {
     auto path = join_paths(DATA_DIR, "portfolio.json");
+    auto snap = std::make_shared<Snapshot>();
+    snap->list["projects"] = {};
+    if (!file_stamp(path, snap->mtime, snap->size)) {
+        Logger::instance().log(LogLevel::Warn, "portfolio.json not found");
+        return snap;
+    }
     auto content = read_file(path);
     if (!content) {
         Logger::instance().log(LogLevel::Warn, "portfolio.json not found");
-        return {};
+        return snap;
+    }
+    auto projects = parse_projects_json(*content);
+    auto& list = snap->list["projects"];
+    for (auto& p : projects) {
+        auto pit = p.find("id");
+        if (pit != p.end()) snap->by_id.emplace(pit->second, snap->items.size());
+        snap->items.push_back(Lists{{"item", {p}}});
+        list.push_back(std::move(p));
     }
-    return parse_projects_json(*content);
+    return snap;
+}
+
+std::shared_ptr<const PortfolioModule::Snapshot> PortfolioModule::snapshot() {
+    auto snap = snapshot_.load();
+    auto now = steady_ms();
+    if (snap && now - checked_ms_.load(std::memory_order_relaxed) < 1000) return snap;
+    if (checking_.exchange(true)) {
+        if (snap) return snap;
+        return load_snapshot();
+    }
+    snap = snapshot_.load();
+    std::int64_t mtime = -1;
+    std::uint64_t size = 0;
+    file_stamp(join_paths(DATA_DIR, "portfolio.json"), mtime, size);
+    if (!snap || mtime != snap->mtime || size != snap->size) {
+        snap = load_snapshot();
+        snapshot_.store(snap);
+    }
+    checked_ms_ = now;
+    checking_ = false;
+    return snap;
 }
 
 Response PortfolioModule::render_list(Router& router) {
-    auto projects = load_projects();
-    Lists lists;
-    lists["projects"] = {};
-    for (auto& p : projects) lists["projects"].push_back(p);
+    auto snap = snapshot();
     Vars vars{{"title","Portfolio"}, {"message","Projects"}};
-    return router.render("portfolio.html", vars, lists);
+    return router.render("portfolio.html", vars, snap->list);
 }
 
 Response PortfolioModule::render_item(Router& router, const Request& req) {
-    std::string id;
-    auto it = req.query.find("id");
-    if (it != req.query.end()) id = it->second;
-    auto projects = load_projects();
+    std::string id(req.param("id"));
+    if (id.empty()) {
+        auto it = req.query.find("id");
+        if (it != req.query.end()) id = it->second;
+    }
+    auto snap = snapshot();
     Vars vars{{"title","Project"}, {"message","Project"}};
-    Lists lists;
-    for (auto& p : projects) {
-        auto pit = p.find("id");
-        if (pit != p.end() && pit->second == id) {
-            lists["item"] = { p };
-            break;
+    auto it = snap->by_id.find(id);
+    if (it == snap->by_id.end()) return router.render("portfolio_item.html", vars);
+    return router.render("portfolio_item.html", vars, snap->items[it->second]);
+}
+
+static void append_json_string(std::string& out, const std::string& s) {
+    static constexpr char kHex[] = "0123456789abcdef";
+    out += '"';
+    for (char c : s) {
+        auto u = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (u < 0x20) {
+            out += "\\u00";
+            out += kHex[u >> 4];
+            out += kHex[u & 15];
+        } else {
+            out += c;
         }
     }
-    return router.render("portfolio_item.html", vars, lists);
+    out += '"';
+}
+
+// Streams the project list as JSON a batch at a time, holding the snapshot it
+// started from so a concurrent reload cannot tear the export.
+Response PortfolioModule::export_json() {
+    static constexpr std::size_t kBatchBytes = 16 * 1024;
+    auto snap = snapshot();
+    auto next = std::make_shared<std::size_t>(0);
+    Response resp;
+    resp.status = 200;
+    resp.headers["Content-Type"] = "application/json";
+    resp.stream = [snap, next](std::string& out) {
+        auto& projects = snap->list.at("projects");
+        if (*next == 0) out += '[';
+        while (*next < projects.size() && out.size() < kBatchBytes) {
+            if (*next > 0) out += ',';
+            out += '{';
+            bool first = true;
+            for (auto& [k, v] : projects[*next]) {
+                if (!first) out += ',';
+                first = false;
+                append_json_string(out, k);
+                out += ':';
+                append_json_string(out, v);
+            }
+            out += '}';
+            ++*next;
+        }
+        if (*next < projects.size()) return true;
+        out += "]\n";
+        return false;
+    };
+    return resp;
 }
 
 void PortfolioModule::register_routes(Router& router) {
-    router.add("GET", "/portfolio", [&router](const Request& req){
+    router.add("GET", "/portfolio", [this, &router](const Request& req){
         return render_list(router);
     });
-    router.add("GET", "/portfolio/view", [&router](const Request& req){
+    router.add("GET", "/portfolio.json", [this](const Request&){
+        return export_json();
+    });
+    router.add("GET", "/portfolio/view", [this, &router](const Request& req){
         return render_item(router, req);
     });
+    router.add("GET", "/portfolio/:id", [this, &router](const Request& req){
+        return render_item(router, req);
+    });
+    router.add_warmup([this, &router]{
+        render_list(router);
+        router.render("portfolio_item.html", Vars{});
+    });
 }
 
 }
@@ -2,6 +2,11 @@
 #include "module.hpp"
 #include "file_util.hpp"
 #include "template.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace web {
@@ -12,9 +17,22 @@ public:
     // TODO: Add version
     void register_routes(Router& router) override;
 private:
-    static std::vector<Vars> load_projects();
-    static Response render_list(Router& router);
-    static Response render_item(Router& router, const Request& req);
+    // Parsed portfolio.json, never modified once published.
+    struct Snapshot {
+        Lists list;
+        std::vector<Lists> items;
+        std::unordered_map<std::string, std::size_t> by_id;
+        std::int64_t mtime = -1;
+        std::uint64_t size = 0;
+    };
+    std::atomic<std::shared_ptr<const Snapshot>> snapshot_;
+    std::atomic<std::int64_t> checked_ms_{0};
+    std::atomic<bool> checking_{false};
+    std::shared_ptr<const Snapshot> snapshot();
+    static std::shared_ptr<const Snapshot> load_snapshot();
+    Response render_list(Router& router);
+    Response render_item(Router& router, const Request& req);
+    Response export_json();
 };
 
 }
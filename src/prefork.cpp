@@ -0,0 +1,151 @@
+#include "prefork.hpp"
+#include "logger.hpp"
+#include "metrics.hpp"
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cerrno>
+#include <ctime>
+#if defined(__linux__)
+#include <sys/prctl.h>
+#endif
+#endif
+
+namespace web {
+
+#if defined(_WIN32)
+
+int run_prefork(unsigned, const std::function<int(unsigned)>&) {
+    return -1;
+}
+
+#else
+
+namespace {
+
+volatile std::sig_atomic_t stop_signal = 0;
+
+void on_stop_signal(int sig) {
+    stop_signal = sig;
+}
+
+// Sleeps unless a stop signal arrives first.
+void pause_for(std::chrono::milliseconds d) {
+    timespec ts{static_cast<time_t>(d.count() / 1000), static_cast<long>((d.count() % 1000) * 1000000)};
+    while (!stop_signal && nanosleep(&ts, &ts) != 0 && errno == EINTR) {}
+}
+
+std::string describe_exit(int status) {
+    if (WIFEXITED(status)) return "exited with status " + std::to_string(WEXITSTATUS(status));
+    if (WIFSIGNALED(status)) return "killed by signal " + std::to_string(WTERMSIG(status));
+    return "stopped";
+}
+
+}
+
+int run_prefork(unsigned workers, const std::function<int(unsigned)>& worker) {
+    static constexpr auto kMinUptime = std::chrono::seconds(1);
+    // Longer than the default drain deadline, so workers can finish theirs.
+    static constexpr auto kStopGrace = std::chrono::seconds(15);
+    if (workers == 0) return -1;
+    void* region = Metrics::create_shared(workers);
+    if (!region) Logger::instance().log(LogLevel::Warn, "Shared metrics unavailable; each worker reports only itself");
+
+    struct sigaction sa{};
+    sa.sa_handler = on_stop_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGTERM, &sa, nullptr);
+    sigaction(SIGINT, &sa, nullptr);
+
+    pid_t supervisor = getpid();
+    std::vector<pid_t> pids(workers, -1);
+    std::vector<std::chrono::steady_clock::time_point> started(workers);
+    auto spawn = [&](unsigned i) {
+        Metrics::reset_shared_gauges(region, workers, i);
+        std::fflush(nullptr);
+        pid_t pid = fork();
+        if (pid == 0) {
+            std::signal(SIGTERM, SIG_DFL);
+            std::signal(SIGINT, SIG_DFL);
+#if defined(__linux__)
+            prctl(PR_SET_PDEATHSIG, SIGTERM);
+#endif
+            if (getppid() != supervisor) _exit(0);
+            if (region) Metrics::instance().attach_shared(region, workers, i);
+            _exit(worker(i));
+        }
+        if (pid < 0) {
+            Logger::instance().log(LogLevel::Error, "fork failed for worker " + std::to_string(i) + ": " + std::to_string(errno));
+            return;
+        }
+        pids[i] = pid;
+        started[i] = std::chrono::steady_clock::now();
+    };
+    for (unsigned i = 0; i < workers; ++i) spawn(i);
+    Logger::instance().log(LogLevel::Info, "Supervisor " + std::to_string(supervisor) + " started " + std::to_string(workers) + " workers");
+
+    while (!stop_signal) {
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR) continue;
+            // No children at all: every fork failed. Retry after a pause.
+            pause_for(std::chrono::seconds(1));
+            for (unsigned i = 0; i < workers && !stop_signal; ++i) {
+                if (pids[i] < 0) spawn(i);
+            }
+            continue;
+        }
+        unsigned i = 0;
+        while (i < workers && pids[i] != pid) ++i;
+        if (i == workers) continue;
+        pids[i] = -1;
+        Logger::instance().log(LogLevel::Warn, "Worker " + std::to_string(i) + " (pid " + std::to_string(pid) + ") " + describe_exit(status));
+        if (stop_signal) break;
+        if (std::chrono::steady_clock::now() - started[i] < kMinUptime) pause_for(kMinUptime);
+        if (!stop_signal) spawn(i);
+    }
+
+    Logger::instance().log(LogLevel::Info, "Supervisor stopping workers");
+    for (pid_t pid : pids) {
+        if (pid > 0) kill(pid, SIGTERM);
+    }
+    auto deadline = std::chrono::steady_clock::now() + kStopGrace;
+    unsigned alive = 0;
+    for (pid_t pid : pids) alive += pid > 0 ? 1 : 0;
+    while (alive > 0) {
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, WNOHANG);
+        if (pid > 0) {
+            for (auto& p : pids) {
+                if (p == pid) {
+                    p = -1;
+                    --alive;
+                }
+            }
+            continue;
+        }
+        if (pid < 0 && errno != EINTR) break;
+        if (std::chrono::steady_clock::now() >= deadline) {
+            for (pid_t p : pids) {
+                if (p > 0) kill(p, SIGKILL);
+            }
+            while (waitpid(-1, nullptr, 0) > 0 || errno == EINTR) {}
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    return 0;
+}
+
+#endif
+
+}
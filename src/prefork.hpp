@@ -0,0 +1,13 @@
+#pragma once
+#include <functional>
+
+namespace web {
+
+// Prefork supervisor. Forks `workers` children that each run worker(index)
+// with every descriptor (notably the bound listen socket) inherited,
+// restarts any child that exits, and on SIGINT/SIGTERM stops them all and
+// returns. Children share one metrics region, so /metrics in any of them
+// covers the whole group. Returns -1 without forking where fork is missing.
+int run_prefork(unsigned workers, const std::function<int(unsigned index)>& worker);
+
+}
@@ -0,0 +1,138 @@
+#include "route_tree.hpp"
+#include <cstring>
+
+namespace web {
+
+struct RouteTree::Node {
+    std::string prefix;
+    std::string indices;
+    std::vector<std::unique_ptr<Node>> children;
+    std::unique_ptr<Node> param;
+    std::string param_name;
+    std::unique_ptr<Node> wildcard;
+    std::string wildcard_name;
+    int id = -1;
+};
+
+RouteTree::RouteTree() : root_(std::make_unique<Node>()) {}
+RouteTree::~RouteTree() = default;
+RouteTree::RouteTree(RouteTree&&) noexcept = default;
+RouteTree& RouteTree::operator=(RouteTree&&) noexcept = default;
+
+static std::size_t common_prefix(std::string_view a, std::string_view b) {
+    std::size_t n = 0;
+    while (n < a.size() && n < b.size() && a[n] == b[n]) ++n;
+    return n;
+}
+
+int RouteTree::insert(std::string_view pattern, unsigned id) {
+    Node* node = root_.get();
+    std::size_t pos = 0;
+    unsigned params = 0;
+    while (pos < pattern.size()) {
+        char c = pattern[pos];
+        if (c == ':' || c == '*') {
+            std::size_t end = c == ':' ? pattern.find('/', pos) : pattern.size();
+            if (end == std::string_view::npos) end = pattern.size();
+            std::string name(pattern.substr(pos + 1, end - pos - 1));
+            if (name.empty() || ++params > RouteParams::kMax) return -1;
+            auto& slot = c == ':' ? node->param : node->wildcard;
+            auto& slot_name = c == ':' ? node->param_name : node->wildcard_name;
+            if (!slot) {
+                slot = std::make_unique<Node>();
+                slot_name = name;
+            } else if (slot_name != name) {
+                return -1;
+            }
+            node = slot.get();
+            pos = end;
+            if (c == '*') break;
+            continue;
+        }
+        std::size_t end = pattern.find_first_of(":*", pos);
+        if (end == std::string_view::npos) end = pattern.size();
+        std::string_view run = pattern.substr(pos, end - pos);
+        while (!run.empty()) {
+            auto k = node->indices.find(run[0]);
+            if (k == std::string::npos) {
+                auto child = std::make_unique<Node>();
+                child->prefix = std::string(run);
+                node->indices.push_back(run[0]);
+                node->children.push_back(std::move(child));
+                node = node->children.back().get();
+                break;
+            }
+            auto& child = node->children[k];
+            std::size_t n = common_prefix(child->prefix, run);
+            if (n < child->prefix.size()) {
+                auto mid = std::make_unique<Node>();
+                mid->prefix = child->prefix.substr(0, n);
+                child->prefix.erase(0, n);
+                mid->indices.push_back(child->prefix[0]);
+                mid->children.push_back(std::move(child));
+                child = std::move(mid);
+            }
+            node = child.get();
+            run.remove_prefix(n);
+        }
+        pos = end;
+    }
+    if (node->id < 0) node->id = static_cast<int>(id);
+    return node->id;
+}
+
+int RouteTree::match(std::string_view path, RouteParams& params) const {
+    params.count = 0;
+    return match_node(*root_, path, 0, params);
+}
+
+int RouteTree::match_node(const Node& start, std::string_view path, std::size_t pos, RouteParams& params) {
+    const Node* n = &start;
+    while (true) {
+        if (pos == path.size() && n->id >= 0) return n->id;
+        const Node* next = nullptr;
+        if (pos < path.size()) {
+            const char* idx = n->indices.data();
+            std::size_t k = 0, count = n->indices.size();
+            while (k < count && idx[k] != path[pos]) ++k;
+            if (k < count) {
+                const Node& child = *n->children[k];
+                std::size_t len = child.prefix.size();
+                if (path.size() - pos >= len && std::memcmp(path.data() + pos, child.prefix.data(), len) == 0) next = &child;
+            }
+        }
+        if (!n->param && !n->wildcard) {
+            if (!next) return -1;
+            pos += next->prefix.size();
+            n = next;
+            continue;
+        }
+        if (next) {
+            int r = match_node(*next, path, pos + next->prefix.size(), params);
+            if (r >= 0) return r;
+        }
+        if (n->param && pos < path.size()) {
+            std::size_t end = path.find('/', pos);
+            if (end == std::string_view::npos) end = path.size();
+            if (end > pos && params.count < RouteParams::kMax) {
+                auto& p = params.items[params.count++];
+                p.name = n->param_name;
+                p.off = static_cast<std::uint32_t>(pos);
+                p.len = static_cast<std::uint32_t>(end - pos);
+                int r = match_node(*n->param, path, end, params);
+                if (r >= 0) return r;
+                --params.count;
+            }
+        }
+        if (n->wildcard && n->wildcard->id >= 0 && params.count < RouteParams::kMax) {
+            auto& p = params.items[params.count++];
+            p.name = n->wildcard_name;
+            p.off = static_cast<std::uint32_t>(pos);
+            p.len = static_cast<std::uint32_t>(path.size() - pos);
+            return n->wildcard->id;
+        }
+        return -1;
+    }
+}
+
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "http.hpp"
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace web {
+
+// Compressed radix tree over path patterns. Static edges are matched first,
+// then a ":name" segment (one non-empty path segment), then a "*name"
+// wildcard (the rest of the path). Matching does not allocate; captured
+// parameters are written as offsets into the request path.
+class RouteTree {
+public:
+    RouteTree();
+    ~RouteTree();
+    RouteTree(RouteTree&&) noexcept;
+    RouteTree& operator=(RouteTree&&) noexcept;
+    int insert(std::string_view pattern, unsigned id);
+    int match(std::string_view path, RouteParams& params) const;
+private:
+    struct Node;
+    std::unique_ptr<Node> root_;
+    static int match_node(const Node& n, std::string_view path, std::size_t pos, RouteParams& params);
+};
+
+}
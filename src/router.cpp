@@ -1,15 +1,67 @@
 #include "router.hpp"
 #include "logger.hpp"
+#include <exception>
 #include <sstream>
 
 namespace web {
 
-static std::string route_key(const std::string& m, const std::string& p) {
-    return m + " " + p;
+int Router::insert(const std::string& method, const std::string& path) {
+    RouteTree* tree = nullptr;
+    for (auto& [m, t] : trees_) {
+        if (m == method) tree = &t;
+    }
+    if (!tree) {
+        trees_.emplace_back(method, RouteTree{});
+        tree = &trees_.back().second;
+    }
+    unsigned id = static_cast<unsigned>(handlers_.size());
+    int got = tree->insert(path, id);
+    if (got < 0) {
+        Logger::instance().log(LogLevel::Error, "Invalid route pattern: " + method + " " + path);
+        return -1;
+    }
+    if (static_cast<unsigned>(got) == id) {
+        handlers_.emplace_back();
+        async_handlers_.emplace_back();
+        stream_handlers_.emplace_back();
+        names_.push_back(method + " " + path);
+    }
+    return got;
 }
 
 void Router::add(const std::string& method, const std::string& path, Handler h) {
-    routes_[route_key(method, path)] = std::move(h);
+    int id = insert(method, path);
+    if (id < 0) return;
+    handlers_[id] = std::move(h);
+    async_handlers_[id] = nullptr;
+    stream_handlers_[id] = nullptr;
+}
+
+void Router::add_async(const std::string& method, const std::string& path, AsyncHandler h) {
+    int id = insert(method, path);
+    if (id < 0) return;
+    handlers_[id] = nullptr;
+    async_handlers_[id] = std::move(h);
+    stream_handlers_[id] = nullptr;
+}
+
+void Router::add_streaming(const std::string& method, const std::string& path, StreamHandler h) {
+    int id = insert(method, path);
+    if (id < 0) return;
+    handlers_[id] = nullptr;
+    async_handlers_[id] = nullptr;
+    stream_handlers_[id] = std::move(h);
+}
+
+const StreamHandler* Router::match_streaming(Request& r, unsigned& route_id) const {
+    for (auto& [m, tree] : trees_) {
+        if (m != r.method) continue;
+        int id = tree.match(r.path, r.params);
+        if (id < 0 || !stream_handlers_[id]) break;
+        route_id = static_cast<unsigned>(id);
+        return &stream_handlers_[id];
+    }
+    return nullptr;
 }
 
 void Router::set_static_dir(const std::string& dir) {
@@ -20,29 +72,83 @@ void Router::set_template_dir(const std::string& dir) {
     template_dir_ = dir;
 }
 
+void Router::set_template_check_interval(std::chrono::milliseconds interval) {
+    templates_.set_check_interval(interval);
+}
+
 Response Router::render(const std::string& name, const Vars& vars, const Lists& lists) const {
     auto full = join_paths(template_dir_, name);
-    auto content_opt = read_file(full);
+    auto tpl = templates_.get(full);
     Response resp;
-    if (!content_opt) {
+    if (!tpl) {
         Logger::instance().log(LogLevel::Warn, "Template not found: " + full);
         resp.status = 404;
         resp.body = "Template not found";
         resp.headers["Content-Type"] = "text/plain; charset=utf-8";
         return resp;
     }
-    auto body = engine_.render(*content_opt, vars, lists);
     resp.status = 200;
-    resp.body = body;
+    tpl->render_into(resp.body, vars, lists);
     resp.headers["Content-Type"] = "text/html; charset=utf-8";
     return resp;
 }
 
-Response Router::route(const Request& r) const {
-    auto it = routes_.find(route_key(r.method, r.path));
-    if (it != routes_.end()) {
-        return it->second(r);
+void Router::add_warmup(std::function<void()> hook) {
+    warmups_.push_back(std::move(hook));
+}
+
+void Router::warm_up() const {
+    auto start = std::chrono::steady_clock::now();
+    for (auto& hook : warmups_) {
+        try {
+            hook();
+        } catch (const std::exception& e) {
+            Logger::instance().log(LogLevel::Warn, std::string("Warmup hook failed: ") + e.what());
+        }
+    }
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    Logger::instance().log(LogLevel::Info, "Ran " + std::to_string(warmups_.size()) + " warmup hooks in " + std::to_string(ms) + " ms");
+}
+
+std::vector<std::string> Router::route_names() const {
+    return names_;
+}
+
+Response Router::internal_error() {
+    Response resp;
+    resp.status = 500;
+    resp.body = "Internal Server Error";
+    resp.headers["Content-Type"] = "text/plain; charset=utf-8";
+    return resp;
+}
+
+Response Router::route(Request& r) const {
+    unsigned id = 0;
+    return route(r, id);
+}
+
+Response Router::route(Request& r, unsigned& route_id, const AsyncHandler** deferred) const {
+    for (auto& [m, tree] : trees_) {
+        if (m != r.method) continue;
+        int id = tree.match(r.path, r.params);
+        if (id < 0) break;
+        route_id = static_cast<unsigned>(id);
+        if (handlers_[id]) return handlers_[id](r);
+        if (stream_handlers_[id]) {
+            auto reader = stream_handlers_[id](r);
+            if (!reader) return internal_error();
+            if (!r.body.empty()) reader->read(r.body);
+            return reader->finish();
+        }
+        if (deferred) {
+            *deferred = &async_handlers_[id];
+            return Response{};
+        }
+        if (auto resp = sync_wait(async_handlers_[id](r))) return std::move(*resp);
+        return internal_error();
     }
+    r.params.count = 0;
+    route_id = kUnmatchedRoute;
     if (!static_dir_.empty() && r.method == "GET") {
         std::string rel = r.path;
         if (rel == "/") rel = "/index.html";
@@ -56,16 +162,14 @@ Response Router::route(const Request& r) const {
             return bad;
         }
         auto full = join_paths(static_dir_, rel);
-        if (file_exists(full)) {
+        if (auto file = files_.open(full)) {
+            route_id = kStaticRoute;
             Logger::instance().log(LogLevel::Debug, "Static file: " + full);
-            auto content = read_file(full);
             Response resp;
-            if (content) {
-                resp.status = 200;
-                resp.body = *content;
-                resp.headers["Content-Type"] = guess_mime(full);
-                return resp;
-            }
+            resp.status = 200;
+            resp.file = std::move(file);
+            resp.headers["Content-Type"] = guess_mime(full);
+            return resp;
         }
     }
     Response resp;
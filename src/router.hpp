@@ -1,27 +1,67 @@
 #pragma once
 #include "http.hpp"
 #include "file_util.hpp"
+#include "file_cache.hpp"
 #include "template.hpp"
+#include "route_tree.hpp"
+#include "task.hpp"
+#include <chrono>
 #include <functional>
+#include <memory>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 namespace web {
 
 using Handler = std::function<Response(const Request&)>;
+using AsyncHandler = std::function<Task<Response>(const Request&)>;
+
+// Receives a request body as it arrives instead of after it has been
+// buffered. read() is called once per decoded piece; returning false stops
+// the upload, and finish() is then called early and the connection closed.
+class BodyReader {
+public:
+    virtual ~BodyReader() = default;
+    virtual bool read(std::string_view chunk) = 0;
+    virtual Response finish() = 0;
+};
+
+using StreamHandler = std::function<std::unique_ptr<BodyReader>(const Request&)>;
 
 class Router {
 public:
     void add(const std::string& method, const std::string& path, Handler h);
+    void add_async(const std::string& method, const std::string& path, AsyncHandler h);
+    void add_streaming(const std::string& method, const std::string& path, StreamHandler h);
     void set_static_dir(const std::string& dir);
     void set_template_dir(const std::string& dir);
-    Response route(const Request& r) const;
+    void set_template_check_interval(std::chrono::milliseconds interval);
+    static constexpr unsigned kStaticRoute = 0;
+    static constexpr unsigned kUnmatchedRoute = 1;
+    Response route(Request& r) const;
+    Response route(Request& r, unsigned& route_id, const AsyncHandler** deferred = nullptr) const;
+    static Response internal_error();
+    const StreamHandler* match_streaming(Request& r, unsigned& route_id) const;
+    std::vector<std::string> route_names() const;
     Response render(const std::string& name, const Vars& vars, const Lists& lists = {}) const;
+    // Hooks that fill caches (templates, parsed data, compiled styles) before
+    // the server takes traffic, e.g. ahead of a listener handoff.
+    void add_warmup(std::function<void()> hook);
+    void warm_up() const;
 private:
-    std::unordered_map<std::string, Handler> routes_;
+    std::vector<std::pair<std::string, RouteTree>> trees_;
+    std::vector<Handler> handlers_{Handler{}, Handler{}};
+    std::vector<AsyncHandler> async_handlers_{AsyncHandler{}, AsyncHandler{}};
+    std::vector<StreamHandler> stream_handlers_{StreamHandler{}, StreamHandler{}};
+    std::vector<std::string> names_{"static", "unmatched"};
+    std::vector<std::function<void()>> warmups_;
     std::string static_dir_;
     std::string template_dir_;
-    TemplateEngine engine_;
+    mutable TemplateCache templates_;
+    mutable FileCache files_;
+    int insert(const std::string& method, const std::string& path);
 };
 
 }
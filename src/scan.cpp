@@ -0,0 +1,230 @@
+#include "scan.hpp"
+#include <array>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define WEB_SCAN_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+namespace web {
+
+static const std::array<bool, 256> kTokenTable = [] {
+    std::array<bool, 256> t{};
+    for (int c = '0'; c <= '9'; ++c) t[c] = true;
+    for (int c = 'a'; c <= 'z'; ++c) t[c] = true;
+    for (int c = 'A'; c <= 'Z'; ++c) t[c] = true;
+    for (unsigned char c : std::string_view("!#$%&'*+-.^_`|~")) t[c] = true;
+    return t;
+}();
+
+bool is_token_char(unsigned char c) {
+    return kTokenTable[c];
+}
+
+static bool target_stop(unsigned char c) {
+    return c <= 0x20 || c == 0x7f;
+}
+
+static bool value_stop(unsigned char c) {
+    return (c < 0x20 && c != '\t') || c == 0x7f;
+}
+
+static std::size_t scan_target_scalar(const char* d, std::size_t i, std::size_t n) {
+    while (i < n && !target_stop(static_cast<unsigned char>(d[i]))) ++i;
+    return i;
+}
+
+static std::size_t scan_value_scalar(const char* d, std::size_t i, std::size_t n) {
+    while (i < n && !value_stop(static_cast<unsigned char>(d[i]))) ++i;
+    return i;
+}
+
+static std::size_t scan_token_scalar(const char* d, std::size_t i, std::size_t n) {
+    while (i < n && kTokenTable[static_cast<unsigned char>(d[i])]) ++i;
+    return i;
+}
+
+#if defined(WEB_SCAN_X86)
+
+static unsigned first_bit(unsigned m) {
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanForward(&idx, m);
+    return static_cast<unsigned>(idx);
+#else
+    return static_cast<unsigned>(__builtin_ctz(m));
+#endif
+}
+
+// Unsigned "v <= limit" is min(v, limit) == v.
+static std::size_t scan_target_sse2(const char* d, std::size_t i, std::size_t n) {
+    const __m128i sp = _mm_set1_epi8(0x20);
+    const __m128i del = _mm_set1_epi8(0x7f);
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(d + i));
+        __m128i m = _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(v, sp), v), _mm_cmpeq_epi8(v, del));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(m));
+        if (mask) return i + first_bit(mask);
+    }
+    return scan_target_scalar(d, i, n);
+}
+
+static std::size_t scan_value_sse2(const char* d, std::size_t i, std::size_t n) {
+    const __m128i ctl = _mm_set1_epi8(0x1f);
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i del = _mm_set1_epi8(0x7f);
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(d + i));
+        __m128i lt = _mm_andnot_si128(_mm_cmpeq_epi8(v, tab), _mm_cmpeq_epi8(_mm_min_epu8(v, ctl), v));
+        __m128i m = _mm_or_si128(lt, _mm_cmpeq_epi8(v, del));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(m));
+        if (mask) return i + first_bit(mask);
+    }
+    return scan_value_scalar(d, i, n);
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+#define WEB_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define WEB_TARGET_AVX2
+#endif
+
+WEB_TARGET_AVX2 static std::size_t scan_target_avx2(const char* d, std::size_t i, std::size_t n) {
+    const __m256i sp = _mm256_set1_epi8(0x20);
+    const __m256i del = _mm256_set1_epi8(0x7f);
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(d + i));
+        __m256i m = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_min_epu8(v, sp), v), _mm256_cmpeq_epi8(v, del));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(m));
+        if (mask) return i + first_bit(mask);
+    }
+    _mm256_zeroupper();
+    return scan_target_sse2(d, i, n);
+}
+
+WEB_TARGET_AVX2 static std::size_t scan_value_avx2(const char* d, std::size_t i, std::size_t n) {
+    const __m256i ctl = _mm256_set1_epi8(0x1f);
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i del = _mm256_set1_epi8(0x7f);
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(d + i));
+        __m256i lt = _mm256_andnot_si256(_mm256_cmpeq_epi8(v, tab), _mm256_cmpeq_epi8(_mm256_min_epu8(v, ctl), v));
+        __m256i m = _mm256_or_si256(lt, _mm256_cmpeq_epi8(v, del));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(m));
+        if (mask) return i + first_bit(mask);
+    }
+    _mm256_zeroupper();
+    return scan_value_sse2(d, i, n);
+}
+
+// tchars only occur in rows 0x2-0x7 of the ASCII table. For each low
+// nibble, kTokenRows holds one bit per row in which that column is a tchar;
+// kRowBit maps a high nibble to its row's bit (zero outside 0x2-0x7, which
+// also covers bytes >= 0x80). A byte is a tchar iff the two lookups share a
+// bit.
+static const std::array<unsigned char, 16> kTokenRows = [] {
+    std::array<unsigned char, 16> t{};
+    for (int row = 2; row < 8; ++row) {
+        for (int col = 0; col < 16; ++col) {
+            if (kTokenTable[(row << 4) | col]) t[col] = static_cast<unsigned char>(t[col] | (1 << (row - 2)));
+        }
+    }
+    return t;
+}();
+
+static const std::array<unsigned char, 16> kRowBit = {0, 0, 1, 2, 4, 8, 16, 32, 0, 0, 0, 0, 0, 0, 0, 0};
+
+WEB_TARGET_AVX2 static std::size_t scan_token_avx2(const char* d, std::size_t i, std::size_t n) {
+    const __m128i rows128 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kTokenRows.data()));
+    const __m128i bits128 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kRowBit.data()));
+    const __m128i nib128 = _mm_set1_epi8(0x0f);
+    if (i + 32 <= n) {
+        const __m256i rows = _mm256_broadcastsi128_si256(rows128);
+        const __m256i bits = _mm256_broadcastsi128_si256(bits128);
+        const __m256i nib = _mm256_set1_epi8(0x0f);
+        const __m256i zero = _mm256_setzero_si256();
+        for (; i + 32 <= n; i += 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(d + i));
+            __m256i lo = _mm256_shuffle_epi8(rows, _mm256_and_si256(v, nib));
+            __m256i hi = _mm256_shuffle_epi8(bits, _mm256_and_si256(_mm256_srli_epi16(v, 4), nib));
+            __m256i m = _mm256_cmpeq_epi8(_mm256_and_si256(lo, hi), zero);
+            unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(m));
+            if (mask) {
+                _mm256_zeroupper();
+                return i + first_bit(mask);
+            }
+        }
+        _mm256_zeroupper();
+    }
+    // Header names are mostly shorter than 32 bytes; take one 16-byte step
+    // before falling back to the table.
+    if (i + 16 <= n) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(d + i));
+        __m128i lo = _mm_shuffle_epi8(rows128, _mm_and_si128(v, nib128));
+        __m128i hi = _mm_shuffle_epi8(bits128, _mm_and_si128(_mm_srli_epi16(v, 4), nib128));
+        __m128i m = _mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128());
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(m));
+        if (mask) return i + first_bit(mask);
+        i += 16;
+    }
+    return scan_token_scalar(d, i, n);
+}
+
+static bool cpu_has_avx2() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (!osxsave || (_xgetbv(0) & 0x6) != 0x6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+struct ScanImpl {
+    std::size_t (*target)(const char*, std::size_t, std::size_t);
+    std::size_t (*value)(const char*, std::size_t, std::size_t);
+    std::size_t (*token)(const char*, std::size_t, std::size_t);
+    const char* name;
+};
+
+static ScanImpl pick_impl() {
+#if defined(WEB_SCAN_X86)
+    if (cpu_has_avx2()) return {scan_target_avx2, scan_value_avx2, scan_token_avx2, "avx2"};
+    // The token lookup needs pshufb (SSSE3), which SSE2 alone lacks.
+    return {scan_target_sse2, scan_value_sse2, scan_token_scalar, "sse2"};
+#else
+    return {scan_target_scalar, scan_value_scalar, scan_token_scalar, "scalar"};
+#endif
+}
+
+static const ScanImpl kImpl = pick_impl();
+
+std::size_t scan_target(const char* d, std::size_t from, std::size_t n) {
+    return kImpl.target(d, from, n);
+}
+
+std::size_t scan_value(const char* d, std::size_t from, std::size_t n) {
+    return kImpl.value(d, from, n);
+}
+
+std::size_t scan_token(const char* d, std::size_t from, std::size_t n) {
+    return kImpl.token(d, from, n);
+}
+
+const char* scan_impl_name() {
+    return kImpl.name;
+}
+
+}
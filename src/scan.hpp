@@ -0,0 +1,16 @@
+#pragma once
+#include <cstddef>
+
+namespace web {
+
+// Vectorised byte scanners used by the request parser. Each returns the
+// offset of the first byte in [from, n) that terminates the field, or n.
+// The SSE2/AVX2/scalar implementation is picked once at startup.
+std::size_t scan_target(const char* d, std::size_t from, std::size_t n);
+std::size_t scan_value(const char* d, std::size_t from, std::size_t n);
+// Stops at the first byte that is not an RFC 9110 tchar (method, header name).
+std::size_t scan_token(const char* d, std::size_t from, std::size_t n);
+bool is_token_char(unsigned char c);
+const char* scan_impl_name();
+
+}
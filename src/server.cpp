@@ -1,8 +1,11 @@
 #include "server.hpp"
+#include "session.hpp"
+#include "socket_util.hpp"
+#include "metrics.hpp"
+#include <algorithm>
 #include <cstring>
 #include <string>
 #include <chrono>
-#include <string_view>
 
 #if defined(_WIN32)
 #ifndef NOMINMAX
@@ -13,7 +16,6 @@
 #if defined(_WIN32)
 #include <winsock2.h>
 #include <ws2tcpip.h>
-#pragma comment(lib, "ws2_32.lib")
 using socket_t = SOCKET;
 #else
 #include <arpa/inet.h>
@@ -21,178 +23,412 @@ using socket_t = SOCKET;
 #include <sys/socket.h>
 #include <unistd.h>
 using socket_t = int;
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
 #endif
 
 namespace web {
 
-static void close_socket(socket_t s) {
-#if defined(_WIN32)
-    closesocket(s);
-#else
-    close(s);
-#endif
-}
+static constexpr std::chrono::milliseconds kIdlePoll{200};
 
-static bool init_platform() {
-#if defined(_WIN32)
-    WSADATA wsa;
-    return WSAStartup(MAKEWORD(2,2), &wsa) == 0;
-#else
-    return true;
-#endif
+Server::Server(const std::string& host, uint16_t port, const Router& router, ServerConfig cfg)
+    : host_(host), port_(port), router_(router), cfg_(cfg), q_(thread_count(), cfg.queue_capacity == 0 ? 1 : cfg.queue_capacity) {
+    Response busy;
+    busy.status = 503;
+    busy.body = "Service Unavailable";
+    busy.headers["Content-Type"] = "text/plain; charset=utf-8";
+    busy.headers["Retry-After"] = std::to_string(cfg_.retry_after_seconds);
+    busy.headers["Connection"] = "close";
+    std::string head;
+    busy.serialize_head(head, false);
+    auto eol = head.find("\r\n") + 2;
+    overload_status_ = head.substr(0, eol);
+    overload_rest_ = head.substr(eol) + busy.body;
 }
 
-static void cleanup_platform() {
-#if defined(_WIN32)
-    WSACleanup();
-#endif
+Server::~Server() {
+    stop();
 }
 
-Server::Server(const std::string& host, uint16_t port, const Router& router)
-    : host_(host), port_(port), router_(router) {}
+unsigned Server::thread_count() const {
+    if (cfg_.threads > 0) return cfg_.threads;
+    return (std::max)(2u, std::thread::hardware_concurrency());
+}
 
 void Server::start() {
     if (!init_platform()) return;
-
-    listen_fd_ =
-#if defined(_WIN32)
-        static_cast<long long>(::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP));
-#else
-        static_cast<long long>(::socket(AF_INET, SOCK_STREAM, 0));
-#endif
-    if (listen_fd_ < 0) return;
-
-    int opt = 1;
-#if defined(_WIN32)
-    setsockopt(static_cast<socket_t>(listen_fd_), SOL_SOCKET, SO_REUSEADDR, (const char*)&opt, sizeof(opt));
-#else
-    setsockopt(static_cast<socket_t>(listen_fd_), SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
-#endif
-
-    sockaddr_in addr{};
-    addr.sin_family = AF_INET;
-    addr.sin_port = htons(port_);
-    inet_pton(AF_INET, host_.c_str(), &addr.sin_addr);
-    if (::bind(static_cast<socket_t>(listen_fd_), (sockaddr*)&addr, sizeof(addr)) != 0) {
-        close_socket(static_cast<socket_t>(listen_fd_));
-        cleanup_platform();
-        return;
-    }
-    if (::listen(static_cast<socket_t>(listen_fd_), SOMAXCONN) != 0) {
-        close_socket(static_cast<socket_t>(listen_fd_));
+    if (!open_listeners()) {
         cleanup_platform();
         return;
     }
 
     running_ = true;
-    unsigned threads = (std::max)(2u, std::thread::hardware_concurrency());
+    accepting_ = true;
+    tick_http_date();
+    clock_ = std::thread(&Server::clock_loop, this);
+    std::string mode = cfg_.reuse_port ? ", SO_REUSEPORT x" + std::to_string(listeners_.size()) : "";
+    if (cfg_.backend == Backend::Uring) {
+        if (start_uring_loops()) {
+            Logger::instance().log(LogLevel::Info, "Listening on " + host_ + ":" + std::to_string(port_) + " (io_uring, " + std::to_string(rings_.size()) + " rings" + mode + ")");
+            return;
+        }
+        cfg_.backend = Backend::Epoll;
+    }
+    if (cfg_.backend == Backend::Epoll && start_event_loops()) {
+        Logger::instance().log(LogLevel::Info, "Listening on " + host_ + ":" + std::to_string(port_) + " (epoll, " + std::to_string(loops_.size()) + " loops" + mode + ")");
+        return;
+    }
+#if defined(__linux__)
+    // Accept threads poll so stop_accepting() is noticed; a nonblocking
+    // listener keeps a connection taken by another process from parking
+    // accept(). Linux does not pass O_NONBLOCK on to accepted sockets.
+    for (auto l : listeners_) set_nonblocking(l);
+#endif
+    if (cfg_.reuse_port) {
+        for (unsigned i = 0; i < listeners_.size(); ++i) {
+            workers_.emplace_back([this, i]{
+                if (cfg_.pin_threads) pin_current_thread(i);
+                acceptor_loop(listeners_[i]);
+            });
+        }
+        Logger::instance().log(LogLevel::Info, "Listening on " + host_ + ":" + std::to_string(port_) + " (threads" + mode + ")");
+        return;
+    }
+    unsigned threads = thread_count();
     for (unsigned i = 0; i < threads; ++i) {
-        workers_.emplace_back(&Server::worker_loop, this);
+        workers_.emplace_back(&Server::worker_loop, this, i);
     }
-    std::thread(&Server::accept_loop, this).detach();
+    acceptor_ = std::thread(&Server::accept_loop, this);
     Logger::instance().log(LogLevel::Info, "Listening on " + host_ + ":" + std::to_string(port_));
 }
 
+bool Server::open_listeners() {
+    if (cfg_.listen_fd >= 0) {
+        cfg_.reuse_port = false;
+        listeners_.push_back(cfg_.listen_fd);
+        listen_fd_ = cfg_.listen_fd;
+        return true;
+    }
+    if (cfg_.reuse_port && !reuse_port_supported()) {
+        Logger::instance().log(LogLevel::Warn, "SO_REUSEPORT unavailable on this platform, using a shared listener");
+        cfg_.reuse_port = false;
+    }
+    unsigned n = cfg_.reuse_port ? thread_count() : 1;
+    for (unsigned i = 0; i < n; ++i) {
+        long long fd = open_listener(host_, port_, cfg_.reuse_port);
+        if (fd < 0) {
+            Logger::instance().log(LogLevel::Error, "Failed to listen on " + host_ + ":" + std::to_string(port_));
+            for (auto l : listeners_) close_socket(l);
+            listeners_.clear();
+            return false;
+        }
+        listeners_.push_back(fd);
+    }
+    listen_fd_ = listeners_.front();
+    return true;
+}
+
+bool Server::start_event_loops() {
+    if (!EventLoop::supported()) {
+        Logger::instance().log(LogLevel::Warn, "epoll backend unavailable on this platform, using threads");
+        return false;
+    }
+    for (auto l : listeners_) {
+        if (!set_nonblocking(l)) return false;
+    }
+    unsigned n = thread_count();
+    for (unsigned i = 0; i < n; ++i) {
+        long long fd = cfg_.reuse_port ? listeners_[i] : listen_fd_;
+        auto loop = std::make_unique<EventLoop>(router_, cfg_, fd);
+        if (!loop->ok()) {
+            Logger::instance().log(LogLevel::Error, "Failed to create event loop");
+            loops_.clear();
+            return false;
+        }
+        loops_.push_back(std::move(loop));
+    }
+    for (unsigned i = 0; i < loops_.size(); ++i) {
+        EventLoop* l = loops_[i].get();
+        workers_.emplace_back([this, l, i]{
+            if (cfg_.pin_threads) pin_current_thread(i);
+            l->run();
+        });
+    }
+    return true;
+}
+
+bool Server::start_uring_loops() {
+    if (!UringLoop::supported()) {
+        Logger::instance().log(LogLevel::Warn, "io_uring backend unavailable on this kernel, using epoll");
+        return false;
+    }
+    unsigned n = thread_count();
+    for (unsigned i = 0; i < n; ++i) {
+        long long fd = cfg_.reuse_port ? listeners_[i] : listen_fd_;
+        auto ring = std::make_unique<UringLoop>(router_, cfg_, fd);
+        if (!ring->ok()) {
+            Logger::instance().log(LogLevel::Warn, "Failed to create io_uring loop, using epoll");
+            rings_.clear();
+            return false;
+        }
+        rings_.push_back(std::move(ring));
+    }
+    for (unsigned i = 0; i < rings_.size(); ++i) {
+        UringLoop* r = rings_[i].get();
+        workers_.emplace_back([this, r, i]{
+            if (cfg_.pin_threads) pin_current_thread(i);
+            r->run();
+        });
+    }
+    return true;
+}
+
+void Server::stop_accepting() {
+    accepting_ = false;
+    for (auto& l : loops_) l->stop_accepting();
+    for (auto& r : rings_) r->stop_accepting();
+}
+
+bool Server::drain(std::chrono::milliseconds deadline) {
+    begin_drain();
+    stop_accepting();
+    for (auto& l : loops_) l->expire_idle();
+    for (auto& r : rings_) r->expire_idle();
+    auto until = std::chrono::steady_clock::now() + deadline;
+    while (open_sessions() > 0 || q_.size() > 0) {
+        if (std::chrono::steady_clock::now() >= until) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    return true;
+}
+
+DrainReport Server::shutdown() {
+    DrainReport report;
+    auto t0 = std::chrono::steady_clock::now();
+    report.complete = drain(cfg_.drain_timeout);
+    stop();
+    auto counts = drain_counts();
+    report.drained = counts.drained;
+    report.aborted = counts.aborted + queued_aborted_;
+    report.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0);
+    Logger::instance().log(report.aborted > 0 ? LogLevel::Warn : LogLevel::Info,
+        "Shutdown after " + std::to_string(report.elapsed.count()) + " ms: " + std::to_string(report.drained) + " requests drained, " + std::to_string(report.aborted) + " aborted");
+    return report;
+}
+
 void Server::stop() {
-    running_ = false;
-    q_cv_.notify_all();
+    accepting_ = false;
+    {
+        std::lock_guard<std::mutex> lk(clock_mtx_);
+        if (!running_) return;
+        running_ = false;
+    }
+    clock_cv_.notify_all();
+    if (clock_.joinable()) clock_.join();
+    q_.wake_all();
+    q_space_.fetch_add(1, std::memory_order_release);
+    q_space_.notify_all();
+    for (auto& l : loops_) l->stop();
+    for (auto& r : rings_) r->stop();
+    if (cfg_.reuse_port) {
+        for (auto l : listeners_) shutdown_socket(l);
+    }
+    if (acceptor_.joinable()) acceptor_.join();
+    {
+        // Thread-backend connections still open here have outlived the
+        // drain; shutting them down wakes their blocked recv/send.
+        std::lock_guard<std::mutex> lk(serving_mtx_);
+        for (auto c : serving_) shutdown_socket(c);
+    }
     for (auto& t : workers_) {
         if (t.joinable()) t.join();
     }
-    if (listen_fd_ >= 0) {
-        close_socket(static_cast<socket_t>(listen_fd_));
-        listen_fd_ = -1;
+    workers_.clear();
+    loops_.clear();
+    rings_.clear();
+    WorkItem left;
+    while (q_.pop_oldest(left)) {
+        Metrics::instance().queue_popped();
+        if (draining()) ++queued_aborted_;
+        reject(left.s);
     }
+    for (auto l : listeners_) close_socket(l);
+    listeners_.clear();
+    listen_fd_ = -1;
     cleanup_platform();
 }
 
-void Server::accept_loop() {
+void Server::clock_loop() {
+    std::unique_lock<std::mutex> lk(clock_mtx_);
     while (running_) {
+        clock_cv_.wait_for(lk, std::chrono::seconds(1), [&]{ return !running_; });
+        tick_http_date();
+    }
+}
+
+void Server::accept_loop() {
+    while (running_ && accepting_) {
+        if (cfg_.overload == Overload::PauseAccept && q_.size() >= q_.capacity()) {
+            auto seen = q_space_.load(std::memory_order_acquire);
+            if (q_.size() >= q_.capacity() && running_) q_space_.wait(seen, std::memory_order_acquire);
+            continue;
+        }
         sockaddr_in caddr{};
         #if defined(_WIN32)
         int clen = sizeof(caddr);
         #else
         socklen_t clen = sizeof(caddr);
         #endif
+        if (!wait_readable(listen_fd_, std::chrono::milliseconds(200))) continue;
         socket_t c = ::accept(static_cast<socket_t>(listen_fd_), (sockaddr*)&caddr, &clen);
         if (c == socket_t(-1)) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            if (!would_block()) std::this_thread::sleep_for(std::chrono::milliseconds(10));
             continue;
         }
         char ipbuf[INET_ADDRSTRLEN]{};
         inet_ntop(AF_INET, &caddr.sin_addr, ipbuf, sizeof(ipbuf));
-        std::string remote = std::string(ipbuf) + ":" + std::to_string(ntohs(caddr.sin_port));
-        {
-            std::lock_guard<std::mutex> lk(q_mtx_);
-            q_.push(WorkItem{static_cast<long long>(c), remote});
-        }
-        q_cv_.notify_one();
+        WorkItem item;
+        item.s = static_cast<long long>(c);
+        item.remote = std::string(ipbuf) + ":" + std::to_string(ntohs(caddr.sin_port));
+        item.queued = std::chrono::steady_clock::now();
+        enqueue(std::move(item));
     }
 }
 
-void Server::worker_loop() {
-    while (running_) {
-        WorkItem item{ -1, "" };
-        {
-            std::unique_lock<std::mutex> lk(q_mtx_);
-            q_cv_.wait(lk, [&]{ return !running_ || !q_.empty(); });
-            if (!running_) break;
-            item = q_.front();
-            q_.pop();
+bool Server::enqueue(WorkItem&& item) {
+    while (!q_.push(std::move(item))) {
+        if (cfg_.overload == Overload::DropOldest) {
+            WorkItem oldest;
+            if (q_.pop_oldest(oldest)) {
+                Metrics::instance().queue_popped();
+                reject(oldest.s);
+            }
+            continue;
         }
-        socket_t c = static_cast<socket_t>(item.s);
-        std::string buf;
-        buf.resize(8192);
-        int total = 0;
-        bool header_done = false;
-        static std::atomic<unsigned long long> rid{0};
-        unsigned long long req_id = ++rid;
-        auto t0 = std::chrono::steady_clock::now();
-        while (true) {
+        if (cfg_.overload == Overload::PauseAccept && running_) {
+            auto seen = q_space_.load(std::memory_order_acquire);
+            if (q_.size() >= q_.capacity()) q_space_.wait(seen, std::memory_order_acquire);
+            continue;
+        }
+        reject(item.s);
+        return false;
+    }
+    Metrics::instance().queue_pushed();
+    return true;
+}
+
+void Server::reject(long long s) {
+    thread_local std::string buf;
+    buf.assign(overload_status_);
+    buf += "Date: ";
+    buf += http_date_now();
+    buf += "\r\n";
+    buf += overload_rest_;
 #if defined(_WIN32)
-            int n = ::recv(c, buf.data() + total, int(buf.size() - total), 0);
+    ::send(static_cast<socket_t>(s), buf.data(), static_cast<int>(buf.size()), 0);
 #else
-            int n = ::recv(c, buf.data() + total, buf.size() - total, 0);
+    ::send(static_cast<socket_t>(s), buf.data(), buf.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
 #endif
-            if (n <= 0) break;
-            total += n;
-            if (total >= 4) {
-                auto pos = std::string_view(buf.data(), total).find("\r\n\r\n");
-                if (pos != std::string::npos) {
-                    header_done = true;
-                    break;
-                }
+    close_socket(s);
+    Metrics::instance().connection_shed();
+}
+
+void Server::worker_loop(unsigned index) {
+    WorkItem item;
+    while (running_) {
+        if (!q_.pop(index, item)) {
+            q_.park(index, running_);
+            continue;
+        }
+        Metrics::instance().queue_popped();
+        Metrics::instance().record_queue_wait(std::chrono::steady_clock::now() - item.queued);
+        if (cfg_.overload == Overload::PauseAccept) {
+            q_space_.fetch_add(1, std::memory_order_release);
+            q_space_.notify_one();
+        }
+        serve(item.s, item.remote);
+    }
+}
+
+void Server::acceptor_loop(long long listen_fd) {
+    while (running_ && accepting_) {
+        sockaddr_in caddr{};
+        #if defined(_WIN32)
+        int clen = sizeof(caddr);
+        #else
+        socklen_t clen = sizeof(caddr);
+        #endif
+        if (!wait_readable(listen_fd, std::chrono::milliseconds(200))) continue;
+        socket_t c = ::accept(static_cast<socket_t>(listen_fd), (sockaddr*)&caddr, &clen);
+        if (c == socket_t(-1)) {
+            if (!running_) break;
+            if (!would_block()) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+        char ipbuf[INET_ADDRSTRLEN]{};
+        inet_ntop(AF_INET, &caddr.sin_addr, ipbuf, sizeof(ipbuf));
+        serve(static_cast<long long>(c), std::string(ipbuf) + ":" + std::to_string(ntohs(caddr.sin_port)));
+    }
+}
+
+void Server::serve(long long s, const std::string& remote) {
+    socket_t c = static_cast<socket_t>(s);
+    set_send_timeout(s, cfg_.write_timeout);
+    Metrics::instance().connection_opened();
+    {
+        std::lock_guard<std::mutex> lk(serving_mtx_);
+        serving_.insert(s);
+    }
+    Session session;
+    session.remote = remote;
+    char buf[8192];
+    std::chrono::steady_clock::time_point applied{};
+    while (true) {
+        // The header deadline does not move while bytes trickle in, so its
+        // remaining time is re-applied before every read.
+        std::chrono::steady_clock::time_point at;
+        auto deadline = next_deadline(session, cfg_, at);
+        // Idle keep-alive connections wait in short polls so a drain can
+        // close them without sitting out the idle timeout.
+        if (deadline == Deadline::Idle) {
+            auto now = std::chrono::steady_clock::now();
+            if (at <= now) {
+                expire_deadline(session, deadline);
+                break;
             }
-            if (total == (int)buf.size()) buf.resize(buf.size() * 2);
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(at - now);
+            if (!wait_readable(s, (std::min)(left + std::chrono::milliseconds(1), kIdlePoll))) continue;
         }
-        std::string data(buf.data(), total);
-        Response resp;
-        if (!header_done) {
-            resp.status = 400;
-            resp.body = "Bad Request";
-            resp.headers["Content-Type"] = "text/plain; charset=utf-8";
-        } else {
-            auto req = parse_request(data);
-            resp = router_.route(req);
-            resp.headers["Connection"] = "close";
-            resp.headers["X-Request-ID"] = std::to_string(req_id);
-            auto t1 = std::chrono::steady_clock::now();
-            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
-            Logger::instance().log(LogLevel::Info, req.method + " " + req.raw_target + " -> " + std::to_string(resp.status) + " " + std::to_string(resp.body.size()) + "B " + std::to_string(ms) + "ms " + item.remote);
+        if (deadline != Deadline::None && (at != applied || deadline == Deadline::Header)) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(at - std::chrono::steady_clock::now());
+            set_recv_timeout(s, (std::max)(left, std::chrono::milliseconds(1)));
+            applied = at;
         }
-        auto out = resp.to_string();
-        size_t sent = 0;
-        while (sent < out.size()) {
 #if defined(_WIN32)
-            int n = ::send(c, out.data() + sent, int(out.size() - sent), 0);
+        int n = ::recv(c, buf, int(sizeof(buf)), 0);
 #else
-            ssize_t n = ::send(c, out.data() + sent, out.size() - sent, 0);
+        int n = ::recv(c, buf, sizeof(buf), 0);
 #endif
-            if (n <= 0) break;
-            sent += n;
+        if (n < 0 && timed_out()) {
+            expire_deadline(session, deadline);
+        } else if (n <= 0) {
+            reject_incomplete(session);
+        } else {
+            append_input(session, buf, static_cast<size_t>(n));
+            process_input(session, router_, cfg_);
         }
-        close_socket(c);
+        auto st = flush_output(session, s);
+        if (st == IoStatus::WouldBlock) expire_deadline(session, Deadline::Write);
+        if (st != IoStatus::Done) break;
+        if (session.close_after_write) break;
+    }
+    {
+        std::lock_guard<std::mutex> lk(serving_mtx_);
+        serving_.erase(s);
     }
+    close_socket(s);
+    Metrics::instance().connection_closed();
 }
 
 }
@@ -2,35 +2,90 @@
 #include "http.hpp"
 #include "router.hpp"
 #include "logger.hpp"
+#include "event_loop.hpp"
+#include "uring_loop.hpp"
+#include "server_config.hpp"
+#include "work_queue.hpp"
 #include <atomic>
+#include <chrono>
 #include <thread>
 #include <vector>
-#include <queue>
+#include <memory>
 #include <mutex>
 #include <condition_variable>
 #include <cstdint>
 #include <string>
+#include <unordered_set>
 
 namespace web {
 
+// Outcome of a graceful shutdown: requests answered after the drain began,
+// and connections closed mid-request or still queued when it ran out.
+struct DrainReport {
+    std::uint64_t drained = 0;
+    std::uint64_t aborted = 0;
+    bool complete = false;
+    std::chrono::milliseconds elapsed{0};
+};
+
 class Server {
 public:
-    Server(const std::string& host, uint16_t port, const Router& router);
+    Server(const std::string& host, uint16_t port, const Router& router, ServerConfig cfg = {});
+    ~Server();
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
     void start();
     void stop();
+    // drain() bounded by cfg.drain_timeout, then stop(). Whatever is still
+    // open at the deadline is closed and reported as aborted.
+    DrainReport shutdown();
+    // Stops taking new connections on every backend; the listen socket stays
+    // open so a successor process holding a copy keeps accepting on it.
+    void stop_accepting();
+    // Stops accepting, turns off keep-alive and waits up to `deadline` for
+    // open and queued connections to finish. Returns true if all did.
+    bool drain(std::chrono::milliseconds deadline);
+    long long listener() const { return listen_fd_; }
 private:
     std::string host_;
     uint16_t port_;
     const Router& router_;
+    ServerConfig cfg_;
     std::atomic<bool> running_{false};
+    std::atomic<bool> accepting_{false};
     std::vector<std::thread> workers_;
-    std::mutex q_mtx_;
-    std::condition_variable q_cv_;
-    struct WorkItem { long long s; std::string remote; };
-    std::queue<WorkItem> q_;
+    std::thread acceptor_;
+    std::thread clock_;
+    std::mutex clock_mtx_;
+    std::condition_variable clock_cv_;
+    std::vector<std::unique_ptr<EventLoop>> loops_;
+    std::vector<std::unique_ptr<UringLoop>> rings_;
+    struct WorkItem {
+        long long s = -1;
+        std::string remote;
+        std::chrono::steady_clock::time_point queued;
+    };
+    StealingQueues<WorkItem> q_;
+    std::atomic<std::uint32_t> q_space_{0};
+    // Cached 503, minus the Date header reject() inserts after the status line.
+    std::string overload_status_;
+    std::string overload_rest_;
     long long listen_fd_{-1};
+    std::vector<long long> listeners_;
+    std::mutex serving_mtx_;
+    std::unordered_set<long long> serving_;
+    std::uint64_t queued_aborted_{0};
+    unsigned thread_count() const;
+    bool open_listeners();
+    bool start_event_loops();
+    bool start_uring_loops();
     void accept_loop();
-    void worker_loop();
+    void clock_loop();
+    void worker_loop(unsigned index);
+    void acceptor_loop(long long listen_fd);
+    void serve(long long s, const std::string& remote);
+    bool enqueue(WorkItem&& item);
+    void reject(long long s);
 };
 
 }
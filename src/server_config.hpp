@@ -0,0 +1,35 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace web {
+
+enum class Backend { Threads, Epoll, Uring };
+
+// What the thread backend does with a new connection when the work queue is
+// full: answer 503 and close it, stop accepting until a worker frees a slot,
+// or evict the oldest queued connection (which gets the 503 instead).
+enum class Overload { Reject503, PauseAccept, DropOldest };
+
+struct ServerConfig {
+    Backend backend = Backend::Threads;
+    unsigned threads = 0;
+    bool reuse_port = false;
+    bool pin_threads = false;
+    bool keep_alive = true;
+    unsigned max_requests_per_connection = 100;
+    std::chrono::milliseconds idle_timeout{5000};
+    std::chrono::milliseconds header_timeout{10000};
+    std::chrono::milliseconds body_timeout{30000};
+    std::chrono::milliseconds write_timeout{30000};
+    std::chrono::milliseconds drain_timeout{10000};
+    std::size_t queue_capacity = 1024;
+    Overload overload = Overload::Reject503;
+    unsigned retry_after_seconds = 1;
+    std::size_t max_header_size = 16 * 1024;
+    std::uint64_t max_body_size = 8 * 1024 * 1024;
+    long long listen_fd = -1;
+};
+
+}
@@ -0,0 +1,698 @@
+#include "session.hpp"
+#include "socket_util.hpp"
+#include "logger.hpp"
+#include "file_cache.hpp"
+#include "metrics.hpp"
+#include <atomic>
+#include <cctype>
+#include <exception>
+#include <string_view>
+#include <algorithm>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <io.h>
+#else
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <cerrno>
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#endif
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+#endif
+
+namespace web {
+
+static std::atomic<unsigned long long> next_request_id{0};
+static constexpr std::size_t kFileChunk = 1 << 20;
+static constexpr int kMaxSlices = 32;
+
+#if !defined(__linux__)
+static int raw_send(long long fd, const char* data, std::size_t len) {
+    if (len > (std::size_t(1) << 30)) len = std::size_t(1) << 30;
+    for (;;) {
+#if defined(_WIN32)
+        int n = ::send(static_cast<SOCKET>(fd), data, static_cast<int>(len), 0);
+#else
+        ssize_t n = ::send(static_cast<int>(fd), data, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+#endif
+        return static_cast<int>(n);
+    }
+}
+#endif
+
+static bool has_token(std::string_view value, std::string_view token) {
+    size_t i = 0;
+    while (i < value.size()) {
+        while (i < value.size() && (value[i] == ' ' || value[i] == '\t' || value[i] == ',')) ++i;
+        size_t b = i;
+        while (i < value.size() && value[i] != ',') ++i;
+        size_t e = i;
+        while (e > b && (value[e-1] == ' ' || value[e-1] == '\t')) --e;
+        if (e - b != token.size()) continue;
+        bool eq = true;
+        for (size_t k = 0; k < token.size() && eq; ++k) {
+            eq = std::tolower(static_cast<unsigned char>(value[b + k])) == token[k];
+        }
+        if (eq) return true;
+    }
+    return false;
+}
+
+static std::atomic<bool> drain_flag{false};
+static std::atomic<std::size_t> live_sessions{0};
+static std::atomic<std::uint64_t> drained_requests{0};
+static std::atomic<std::uint64_t> aborted_requests{0};
+
+Session::Session() {
+    live_sessions.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Drain accounting happens here, once the fate of the last response is
+// known: a response still queued or discarded counts as aborted, not drained.
+Session::~Session() {
+    live_sessions.fetch_sub(1, std::memory_order_relaxed);
+    if (!draining()) return;
+    bool undelivered = lost_output || !out.empty();
+    unsigned answered = drain_answered;
+    if (undelivered && answered > 0) --answered;
+    if (answered > 0) drained_requests.fetch_add(answered, std::memory_order_relaxed);
+    if (undelivered || awaiting || body.active || !in.empty()) aborted_requests.fetch_add(1, std::memory_order_relaxed);
+}
+
+void begin_drain() {
+    drain_flag.store(true, std::memory_order_relaxed);
+}
+
+bool draining() {
+    return drain_flag.load(std::memory_order_relaxed);
+}
+
+std::size_t open_sessions() {
+    return live_sessions.load(std::memory_order_relaxed);
+}
+
+DrainCounts drain_counts() {
+    DrainCounts c;
+    c.drained = drained_requests.load(std::memory_order_relaxed);
+    c.aborted = aborted_requests.load(std::memory_order_relaxed);
+    return c;
+}
+
+static bool wants_keep_alive(const Request& req, const Response& resp, const Session& s, const ServerConfig& cfg) {
+    if (!cfg.keep_alive || draining()) return false;
+    if (cfg.max_requests_per_connection > 0 && s.requests >= cfg.max_requests_per_connection) return false;
+    auto rc = find_header(resp.headers, "Connection");
+    if (rc && has_token(*rc, "close")) return false;
+    auto c = find_header(req.headers, "Connection");
+    if (req.version == "HTTP/1.1") return !(c && has_token(*c, "close"));
+    if (req.version == "HTTP/1.0") return c && has_token(*c, "keep-alive");
+    return false;
+}
+
+// Repeated Content-Length fields must all carry the same value (RFC 9112
+// section 6.3); otherwise framing and to_request() could disagree on it.
+static bool content_length(const RequestView& req, size_t& len) {
+    len = 0;
+    std::size_t i = req.find_header("Content-Length");
+    if (i == req.header_count) return true;
+    auto v = req.headers[i].value;
+    if (v.empty()) return false;
+    while ((i = req.find_header("Content-Length", i + 1)) < req.header_count) {
+        if (req.headers[i].value != v) return false;
+    }
+    for (char ch : v) {
+        if (ch < '0' || ch > '9') return false;
+        len = len * 10 + static_cast<size_t>(ch - '0');
+        if (len > (size_t(1) << 40)) return false;
+    }
+    return true;
+}
+
+static constexpr std::size_t kSpareLimit = 64 * 1024;
+
+static void queue_response(Session& s, Response& resp) {
+    Outgoing o;
+    o.head = std::move(s.spare);
+    o.head.clear();
+    resp.serialize_head(o.head);
+    o.chunked = resp.streams_chunked();
+    o.stream = std::move(resp.stream);
+    o.file = std::move(resp.file);
+    if (!o.file && !o.stream) o.body = std::move(resp.body);
+    s.out.push_back(std::move(o));
+}
+
+static void recycle(Session& s, std::string&& buf) {
+    if (buf.capacity() <= kSpareLimit && buf.capacity() > s.spare.capacity()) s.spare = std::move(buf);
+}
+
+static void queue_error(Session& s, int status, const char* text) {
+    Response resp;
+    resp.status = status;
+    resp.body = text;
+    resp.headers["Content-Type"] = "text/plain; charset=utf-8";
+    resp.headers["Connection"] = "close";
+    queue_response(s, resp);
+    s.close_after_write = true;
+}
+
+static void queue_bad_request(Session& s) {
+    queue_error(s, 400, "Bad Request");
+}
+
+static void queue_continue(Session& s) {
+    Outgoing o;
+    o.head = "HTTP/1.1 100 Continue\r\n\r\n";
+    s.out.push_back(std::move(o));
+}
+
+static void finish_request(Session& s, const Request& req, Response& resp, unsigned route_id, unsigned long long req_id, std::uint64_t bytes_in, std::chrono::steady_clock::time_point t0, const ServerConfig& cfg) {
+    bool keep = wants_keep_alive(req, resp, s, cfg);
+    if (resp.stream && req.version != "HTTP/1.1" && !find_header(resp.headers, "Content-Length")) {
+        resp.chunked = false;
+        keep = false;
+    }
+    resp.headers["Connection"] = keep ? "keep-alive" : "close";
+    resp.headers["X-Request-ID"] = std::to_string(req_id);
+    auto t1 = std::chrono::steady_clock::now();
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - s.started).count();
+    Logger::instance().log(LogLevel::Info, req.method + " " + req.raw_target + " -> " + std::to_string(resp.status) + " " + std::to_string(resp.content_length()) + "B " + std::to_string(ms) + "ms " + s.remote);
+    int status = resp.status;
+    std::uint64_t bytes_out = resp.content_length();
+    queue_response(s, resp);
+    bytes_out += s.out.back().head.size();
+    Metrics::instance().record_request(route_id, status, bytes_in, bytes_out, t1 - t0);
+    if (draining()) ++s.drain_answered;
+    s.started = t1;
+    if (!keep) s.close_after_write = true;
+}
+
+static void dispatch(Session& s, const Router& router, const ServerConfig& cfg, const AsyncPost* post, Request& req, unsigned long long req_id, std::uint64_t bytes_in, std::chrono::steady_clock::time_point t0) {
+    unsigned route_id = 0;
+    const AsyncHandler* deferred = nullptr;
+    auto resp = router.route(req, route_id, post ? &deferred : nullptr);
+    if (deferred) {
+        auto call = std::make_shared<AsyncCall>();
+        call->req = std::move(req);
+        call->route_id = route_id;
+        call->req_id = req_id;
+        call->bytes_in = bytes_in;
+        call->tag = s.tag;
+        call->t0 = t0;
+        s.awaiting = true;
+        spawn((*deferred)(call->req), [call, deliver = *post](std::optional<Response> r) {
+            call->resp = r ? std::move(*r) : Router::internal_error();
+            deliver(call);
+        });
+        return;
+    }
+    finish_request(s, req, resp, route_id, req_id, bytes_in, t0, cfg);
+}
+
+enum class BodyStatus { Done, NeedMore, Error, TooLarge, Rejected };
+
+static constexpr std::size_t kMaxChunkLine = 1024;
+
+static BodyStatus deliver(Session& s, std::string_view piece, const ServerConfig& cfg) {
+    auto& b = s.body;
+    b.received += piece.size();
+    if (b.reader) return b.reader->read(piece) ? BodyStatus::NeedMore : BodyStatus::Rejected;
+    if (cfg.max_body_size > 0 && b.received > cfg.max_body_size) return BodyStatus::TooLarge;
+    b.req.body.append(piece.data(), piece.size());
+    return BodyStatus::NeedMore;
+}
+
+static bool parse_chunk_size(std::string_view line, std::uint64_t& size) {
+    size = 0;
+    size_t i = 0;
+    while (i < line.size() && std::isxdigit(static_cast<unsigned char>(line[i]))) {
+        if (size >> 56) return false;
+        char c = line[i++];
+        size = size * 16 + static_cast<std::uint64_t>(c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+    }
+    if (i == 0) return false;
+    while (i < line.size() && (line[i] == ' ' || line[i] == '\t')) ++i;
+    return i == line.size() || line[i] == ';';
+}
+
+static BodyStatus feed_body(Session& s, std::string_view in, size_t& used, const ServerConfig& cfg) {
+    auto& b = s.body;
+    used = 0;
+    if (b.mode == BodyState::Mode::Length) {
+        size_t n = static_cast<size_t>((std::min<std::uint64_t>)(b.remaining, in.size()));
+        if (n > 0) {
+            used = n;
+            b.remaining -= n;
+            auto st = deliver(s, in.substr(0, n), cfg);
+            if (st != BodyStatus::NeedMore) return st;
+        }
+        return b.remaining == 0 ? BodyStatus::Done : BodyStatus::NeedMore;
+    }
+    while (true) {
+        switch (b.chunk) {
+            case BodyState::Chunk::Size: {
+                auto eol = in.find("\r\n", used);
+                if (eol == std::string_view::npos) return in.size() - used > kMaxChunkLine ? BodyStatus::Error : BodyStatus::NeedMore;
+                std::uint64_t size = 0;
+                if (eol - used > kMaxChunkLine || !parse_chunk_size(in.substr(used, eol - used), size)) return BodyStatus::Error;
+                used = eol + 2;
+                b.remaining = size;
+                b.chunk = size == 0 ? BodyState::Chunk::Trailer : BodyState::Chunk::Data;
+                break;
+            }
+            case BodyState::Chunk::Data: {
+                size_t n = static_cast<size_t>((std::min<std::uint64_t>)(b.remaining, in.size() - used));
+                if (n == 0) return BodyStatus::NeedMore;
+                auto piece = in.substr(used, n);
+                used += n;
+                b.remaining -= n;
+                if (b.remaining == 0) b.chunk = BodyState::Chunk::DataEnd;
+                auto st = deliver(s, piece, cfg);
+                if (st != BodyStatus::NeedMore) return st;
+                break;
+            }
+            case BodyState::Chunk::DataEnd: {
+                if (in.size() - used < 2) return BodyStatus::NeedMore;
+                if (in.compare(used, 2, "\r\n") != 0) return BodyStatus::Error;
+                used += 2;
+                b.chunk = BodyState::Chunk::Size;
+                break;
+            }
+            case BodyState::Chunk::Trailer: {
+                auto eol = in.find("\r\n", used);
+                if (eol == std::string_view::npos) return in.size() - used > kMaxChunkLine ? BodyStatus::Error : BodyStatus::NeedMore;
+                bool last = eol == used;
+                used = eol + 2;
+                if (last) return BodyStatus::Done;
+                break;
+            }
+        }
+    }
+}
+
+static void end_body(Session& s) {
+    s.body.active = false;
+    s.body.reader.reset();
+    s.body.req = Request{};
+}
+
+static void finish_body(Session& s, const Router& router, const ServerConfig& cfg, const AsyncPost* post, bool aborted) {
+    auto& b = s.body;
+    Request req = std::move(b.req);
+    auto reader = std::move(b.reader);
+    unsigned route_id = b.route_id;
+    unsigned long long req_id = b.req_id;
+    std::uint64_t bytes_in = b.bytes_in;
+    auto t0 = b.t0;
+    end_body(s);
+    if (!reader) {
+        dispatch(s, router, cfg, post, req, req_id, bytes_in, t0);
+        return;
+    }
+    auto resp = reader->finish();
+    if (aborted) resp.headers["Connection"] = "close";
+    finish_request(s, req, resp, route_id, req_id, bytes_in, t0, cfg);
+}
+
+void process_input(Session& s, const Router& router, const ServerConfig& cfg, const AsyncPost* post) {
+    size_t off = 0;
+    while (!s.close_after_write && !s.awaiting) {
+        std::string_view pending(s.in.data() + off, s.in.size() - off);
+        if (s.body.active) {
+            size_t used = 0;
+            auto st = feed_body(s, pending, used, cfg);
+            off += used;
+            s.body.bytes_in += used;
+            if (st == BodyStatus::NeedMore) break;
+            if (st == BodyStatus::Error || st == BodyStatus::TooLarge) {
+                end_body(s);
+                if (st == BodyStatus::Error) queue_bad_request(s);
+                else queue_error(s, 413, "Payload Too Large");
+                break;
+            }
+            finish_body(s, router, cfg, post, st == BodyStatus::Rejected);
+            continue;
+        }
+        auto st = s.parser.parse(pending, cfg.max_header_size > 0 ? cfg.max_header_size : SIZE_MAX);
+        if (st == ParseStatus::NeedMore) break;
+        if (st == ParseStatus::Error) {
+            queue_bad_request(s);
+            break;
+        }
+        if (st == ParseStatus::TooLarge) {
+            queue_error(s, 431, "Request Header Fields Too Large");
+            break;
+        }
+        const RequestView& view = s.parser.request();
+        size_t head_len = view.head_length;
+        size_t body_len = 0;
+        bool chunked = false;
+        if (view.has_header("Transfer-Encoding")) {
+            auto te = view.header("Transfer-Encoding");
+            if (view.has_header("Content-Length")) {
+                queue_bad_request(s);
+                break;
+            }
+            if (!has_token(te, "chunked") || te.find(',') != std::string_view::npos) {
+                queue_error(s, 501, "Not Implemented");
+                break;
+            }
+            chunked = true;
+        } else if (!content_length(view, body_len)) {
+            queue_bad_request(s);
+            break;
+        }
+        bool want_continue = false;
+        if (view.has_header("Expect")) {
+            if (!has_token(view.header("Expect"), "100-continue")) {
+                queue_error(s, 417, "Expectation Failed");
+                break;
+            }
+            want_continue = view.version == "HTTP/1.1";
+        }
+        auto t0 = std::chrono::steady_clock::now();
+        auto req = to_request(view);
+        s.parser.reset();
+        if (!chunked && body_len == 0) {
+            ++s.requests;
+            off += head_len;
+            dispatch(s, router, cfg, post, req, ++next_request_id, head_len, t0);
+            continue;
+        }
+        unsigned route_id = 0;
+        auto stream = router.match_streaming(req, route_id);
+        if (!stream && cfg.max_body_size > 0 && body_len > cfg.max_body_size) {
+            queue_error(s, 413, "Payload Too Large");
+            break;
+        }
+        ++s.requests;
+        off += head_len;
+        auto& b = s.body;
+        b.active = true;
+        b.mode = chunked ? BodyState::Mode::Chunked : BodyState::Mode::Length;
+        b.chunk = BodyState::Chunk::Size;
+        b.remaining = body_len;
+        b.received = 0;
+        b.route_id = route_id;
+        b.req_id = ++next_request_id;
+        b.bytes_in = head_len;
+        b.t0 = t0;
+        b.req = std::move(req);
+        if (stream) {
+            b.reader = (*stream)(b.req);
+            if (!b.reader) {
+                end_body(s);
+                queue_error(s, 500, "Internal Server Error");
+                break;
+            }
+        } else if (!chunked) {
+            b.req.body.reserve(body_len);
+        }
+        if (want_continue && off == s.in.size()) queue_continue(s);
+    }
+    if (s.close_after_write) {
+        s.in.clear();
+        s.parser.reset();
+    } else if (off > 0) {
+        s.in.erase(0, off);
+    }
+    s.last_active = std::chrono::steady_clock::now();
+}
+
+void complete_async(Session& s, AsyncCall& call, const Router& router, const ServerConfig& cfg, const AsyncPost* post) {
+    s.awaiting = false;
+    s.last_write = std::chrono::steady_clock::now();
+    finish_request(s, call.req, call.resp, call.route_id, call.req_id, call.bytes_in, call.t0, cfg);
+    process_input(s, router, cfg, post);
+    if (s.input_closed && !s.awaiting) reject_incomplete(s);
+}
+
+void append_input(Session& s, const char* data, size_t n) {
+    if (s.close_after_write) return;
+    if (s.in.empty()) s.started = std::chrono::steady_clock::now();
+    s.in.append(data, n);
+}
+
+void reject_incomplete(Session& s) {
+    if (s.close_after_write) return;
+    if (s.awaiting) {
+        s.input_closed = true;
+        return;
+    }
+    if (s.requests > 0 && s.in.empty()) {
+        s.close_after_write = true;
+        return;
+    }
+    s.in.clear();
+    queue_bad_request(s);
+}
+
+bool input_full(const Session& s, const ServerConfig& cfg) {
+    std::size_t limit = cfg.max_header_size;
+    if (s.body.active && !s.body.reader && cfg.max_body_size > 0) limit = static_cast<std::size_t>(cfg.max_body_size);
+    return limit > 0 && s.in.size() >= limit;
+}
+
+bool output_pending(const Session& s) {
+    return !s.out.empty();
+}
+
+Deadline next_deadline(const Session& s, const ServerConfig& cfg, std::chrono::steady_clock::time_point& at) {
+    if (s.awaiting) return Deadline::None;
+    if (!s.out.empty()) {
+        at = (std::max)(s.last_write, s.last_active) + cfg.write_timeout;
+        return Deadline::Write;
+    }
+    if (s.close_after_write) return Deadline::None;
+    if (s.body.active) {
+        at = s.last_active + cfg.body_timeout;
+        return Deadline::Body;
+    }
+    if (s.in.empty() && s.requests > 0) {
+        // While draining, an idle keep-alive connection is due at once.
+        at = draining() ? s.last_active : (std::max)(s.last_write, s.last_active) + cfg.idle_timeout;
+        return Deadline::Idle;
+    }
+    at = s.started + cfg.header_timeout;
+    return Deadline::Header;
+}
+
+void expire_deadline(Session& s, Deadline kind) {
+    if (kind != Deadline::None && !(kind == Deadline::Idle && draining())) {
+        Metrics::instance().connection_timed_out(static_cast<unsigned>(kind) - 1);
+    }
+    switch (kind) {
+        case Deadline::None:
+            return;
+        case Deadline::Write:
+            s.lost_output = true;
+            s.out.clear();
+            break;
+        case Deadline::Body:
+            end_body(s);
+            queue_error(s, 408, "Request Timeout");
+            break;
+        case Deadline::Header:
+            if (!s.in.empty()) queue_error(s, 408, "Request Timeout");
+            break;
+        case Deadline::Idle:
+            break;
+    }
+    s.in.clear();
+    s.parser.reset();
+    s.close_after_write = true;
+}
+
+static long long raw_sendv(long long fd, const IoSlice* slices, int count) {
+#if defined(_WIN32)
+    WSABUF bufs[kMaxSlices];
+    for (int i = 0; i < count; ++i) {
+        bufs[i].buf = const_cast<char*>(slices[i].data);
+        bufs[i].len = static_cast<ULONG>((std::min)(slices[i].len, std::size_t(1) << 30));
+    }
+    DWORD sent = 0;
+    if (WSASend(static_cast<SOCKET>(fd), bufs, static_cast<DWORD>(count), &sent, 0, nullptr, nullptr) != 0) return -1;
+    return static_cast<long long>(sent);
+#else
+    iovec iov[kMaxSlices];
+    for (int i = 0; i < count; ++i) {
+        iov[i].iov_base = const_cast<char*>(slices[i].data);
+        iov[i].iov_len = slices[i].len;
+    }
+    msghdr msg{};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = static_cast<decltype(msg.msg_iovlen)>(count);
+    for (;;) {
+        ssize_t n = ::sendmsg(static_cast<int>(fd), &msg, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        return static_cast<long long>(n);
+    }
+#endif
+}
+
+static IoStatus send_file_range(long long fd, Outgoing& o) {
+    while (o.file_off < o.file->size) {
+        std::uint64_t left = o.file->size - o.file_off;
+        std::size_t want = static_cast<std::size_t>(left < kFileChunk ? left : kFileChunk);
+#if defined(__linux__)
+        off_t off = static_cast<off_t>(o.file_off);
+        ssize_t n = ::sendfile(static_cast<int>(fd), o.file->fd, &off, want);
+        if (n > 0) {
+            o.file_off = static_cast<std::uint64_t>(off);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return IoStatus::WouldBlock;
+        return IoStatus::Closed;
+#else
+        thread_local std::string chunk(kFileChunk, '\0');
+#if defined(_WIN32)
+        if (_lseeki64(o.file->fd, static_cast<__int64>(o.file_off), SEEK_SET) < 0) return IoStatus::Closed;
+        int r = _read(o.file->fd, chunk.data(), static_cast<unsigned>(want));
+#else
+        ssize_t r = ::pread(o.file->fd, chunk.data(), want, static_cast<off_t>(o.file_off));
+#endif
+        if (r <= 0) return IoStatus::Closed;
+        std::size_t sent = 0;
+        while (sent < static_cast<std::size_t>(r)) {
+            int n = raw_send(fd, chunk.data() + sent, static_cast<std::size_t>(r) - sent);
+            if (n > 0) {
+                sent += static_cast<std::size_t>(n);
+                continue;
+            }
+            o.file_off += sent;
+            if (n < 0 && would_block()) return IoStatus::WouldBlock;
+            return IoStatus::Closed;
+        }
+        o.file_off += sent;
+#endif
+    }
+    return IoStatus::Done;
+}
+
+// Refills an exhausted streaming entry with the producer's next piece. Called
+// only once the previous piece has been written, so a slow reader holds back
+// the producer instead of growing the queue.
+static bool pull_stream(Outgoing& o) {
+    thread_local std::string piece;
+    piece.clear();
+    bool more;
+    try {
+        more = o.stream(piece);
+    } catch (const std::exception& e) {
+        Logger::instance().log(LogLevel::Error, std::string("Response stream failed: ") + e.what());
+        return false;
+    } catch (...) {
+        Logger::instance().log(LogLevel::Error, "Response stream failed");
+        return false;
+    }
+    o.body.clear();
+    o.body_off = 0;
+    if (o.chunked) append_chunk(o.body, piece, !more);
+    else o.body.swap(piece);
+    if (!more) o.stream = nullptr;
+    if (piece.capacity() > kSpareLimit) std::string().swap(piece);
+    return true;
+}
+
+static IoStatus fail(Session& s) {
+    if (!s.out.empty()) s.lost_output = true;
+    s.out.clear();
+    s.close_after_write = true;
+    return IoStatus::Closed;
+}
+
+static void advance(Session& s, std::size_t n) {
+    while (n > 0 && !s.out.empty()) {
+        Outgoing& o = s.out.front();
+        std::size_t h = (std::min)(n, o.head.size() - o.head_off);
+        o.head_off += h;
+        n -= h;
+        std::size_t b = (std::min)(n, o.body.size() - o.body_off);
+        o.body_off += b;
+        n -= b;
+        if (o.file || o.stream || o.head_off < o.head.size() || o.body_off < o.body.size()) break;
+        recycle(s, std::move(o.head));
+        s.out.pop_front();
+    }
+}
+
+int gather_output(Session& s, IoSlice* slices, int max, bool& complete) {
+    complete = false;
+    while (!s.out.empty()) {
+        Outgoing& o = s.out.front();
+        if (o.head_off < o.head.size() || o.body_off < o.body.size()) break;
+        if (o.stream) {
+            if (!pull_stream(o)) {
+                fail(s);
+                return 0;
+            }
+            continue;
+        }
+        if (o.file) return 0;
+        recycle(s, std::move(o.head));
+        s.out.pop_front();
+    }
+    int count = 0;
+    for (auto& o : s.out) {
+        if (count + 2 > max) return count;
+        if (o.head_off < o.head.size()) slices[count++] = IoSlice{o.head.data() + o.head_off, o.head.size() - o.head_off};
+        if (o.body_off < o.body.size()) slices[count++] = IoSlice{o.body.data() + o.body_off, o.body.size() - o.body_off};
+        if (o.file || o.stream) return count;
+    }
+    complete = true;
+    return count;
+}
+
+void consume_output(Session& s, std::size_t n) {
+    s.last_write = std::chrono::steady_clock::now();
+    advance(s, n);
+}
+
+IoStatus flush_output(Session& s, long long fd) {
+    while (!s.out.empty()) {
+        IoSlice slices[kMaxSlices];
+        int count = 0;
+        for (auto& o : s.out) {
+            if (o.head_off < o.head.size()) slices[count++] = IoSlice{o.head.data() + o.head_off, o.head.size() - o.head_off};
+            if (o.body_off < o.body.size()) slices[count++] = IoSlice{o.body.data() + o.body_off, o.body.size() - o.body_off};
+            if (o.file || o.stream || count + 2 > kMaxSlices) break;
+        }
+        if (count > 0) {
+            long long n = raw_sendv(fd, slices, count);
+            if (n > 0) {
+                s.last_write = std::chrono::steady_clock::now();
+                advance(s, static_cast<std::size_t>(n));
+                continue;
+            }
+            if (n < 0 && would_block()) return IoStatus::WouldBlock;
+            return fail(s);
+        }
+        Outgoing& o = s.out.front();
+        if (o.stream) {
+            if (!pull_stream(o)) return fail(s);
+            continue;
+        }
+        if (o.file) {
+            auto before = o.file_off;
+            auto st = send_file_range(fd, o);
+            if (o.file_off != before) s.last_write = std::chrono::steady_clock::now();
+            if (st == IoStatus::WouldBlock) return st;
+            if (st == IoStatus::Closed) return fail(s);
+        }
+        recycle(s, std::move(o.head));
+        s.out.pop_front();
+    }
+    return IoStatus::Done;
+}
+
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include "http.hpp"
+#include "http_parser.hpp"
+#include "router.hpp"
+#include "server_config.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace web {
+
+struct Outgoing {
+    std::string head;
+    std::string body;
+    std::shared_ptr<const OpenFile> file;
+    BodyProducer stream;
+    bool chunked = false;
+    std::size_t head_off = 0;
+    std::size_t body_off = 0;
+    std::uint64_t file_off = 0;
+};
+
+// Framing state of a request whose head has been parsed but whose body is
+// still arriving. Buffered routes collect the body into req.body; streaming
+// routes hand each decoded piece to reader as soon as it is decoded.
+struct BodyState {
+    enum class Mode { Length, Chunked };
+    enum class Chunk { Size, Data, DataEnd, Trailer };
+    bool active = false;
+    Mode mode = Mode::Length;
+    Chunk chunk = Chunk::Size;
+    std::uint64_t remaining = 0;
+    std::uint64_t received = 0;
+    Request req;
+    std::unique_ptr<BodyReader> reader;
+    unsigned route_id = 0;
+    unsigned long long req_id = 0;
+    std::uint64_t bytes_in = 0;
+    std::chrono::steady_clock::time_point t0;
+};
+
+struct Session {
+    Session();
+    ~Session();
+    Session(const Session&) = delete;
+    Session& operator=(const Session&) = delete;
+    std::string remote;
+    std::string in;
+    RequestParser parser;
+    BodyState body;
+    std::deque<Outgoing> out;
+    std::string spare;
+    unsigned requests = 0;
+    bool close_after_write = false;
+    bool awaiting = false;
+    bool input_closed = false;
+    bool lost_output = false;
+    unsigned drain_answered = 0;
+    std::uint64_t tag = 0;
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point last_active = started;
+    std::chrono::steady_clock::time_point last_write = started;
+};
+
+// A request handed to an async handler. The backend's AsyncPost receives it
+// (on whatever thread the handler finished) and must call complete_async on
+// the thread that owns the session tagged with `tag`.
+struct AsyncCall {
+    Request req;
+    Response resp;
+    unsigned route_id = 0;
+    unsigned long long req_id = 0;
+    std::uint64_t bytes_in = 0;
+    std::uint64_t tag = 0;
+    std::chrono::steady_clock::time_point t0;
+};
+
+using AsyncPost = std::function<void(std::shared_ptr<AsyncCall>)>;
+
+void append_input(Session& s, const char* data, std::size_t n);
+void process_input(Session& s, const Router& router, const ServerConfig& cfg, const AsyncPost* post = nullptr);
+void complete_async(Session& s, AsyncCall& call, const Router& router, const ServerConfig& cfg, const AsyncPost* post);
+void reject_incomplete(Session& s);
+bool output_pending(const Session& s);
+// True once the unparsed input reaches the active limit (the header limit,
+// or max_body_size while a buffered body is read). Backends stop reading
+// until process_input has consumed some of it.
+bool input_full(const Session& s, const ServerConfig& cfg);
+
+// Process-wide drain switch used by upgrades and shutdown: once set, no
+// response offers keep-alive, so connections end after their current
+// request. open_sessions counts live connections across all backends.
+void begin_drain();
+bool draining();
+std::size_t open_sessions();
+
+// Requests answered since the drain began, and connections torn down while
+// a request was still being read, handled or written.
+struct DrainCounts {
+    std::uint64_t drained = 0;
+    std::uint64_t aborted = 0;
+};
+DrainCounts drain_counts();
+
+// The deadline a connection is currently running against. Header is measured
+// from the first byte of the request (or from accept), so trickling bytes
+// does not extend it; Body and Write restart whenever bytes move; Idle covers
+// the gap between keep-alive requests. None while a handler is running.
+enum class Deadline { None, Header, Body, Idle, Write };
+
+Deadline next_deadline(const Session& s, const ServerConfig& cfg, std::chrono::steady_clock::time_point& at);
+// Applies an expired deadline: 408 for a half-read request, otherwise just
+// marks the connection for closing (dropping unsent output on Write).
+void expire_deadline(Session& s, Deadline kind);
+
+enum class IoStatus { Done, WouldBlock, Closed };
+
+IoStatus flush_output(Session& s, long long fd);
+
+struct IoSlice {
+    const char* data;
+    std::size_t len;
+};
+
+// For completion-based backends: gather_output lists up to max queued
+// buffers for one vectored send, first refilling a drained stream. It
+// returns 0 with output still pending when a file is next (flush_output
+// sends those), and sets complete when the slices cover all queued output.
+// consume_output retires n bytes once the send completes.
+int gather_output(Session& s, IoSlice* slices, int max, bool& complete);
+void consume_output(Session& s, std::size_t n);
+
+}
@@ -0,0 +1,204 @@
+#include "socket_util.hpp"
+#include <thread>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#endif
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+using socket_t = SOCKET;
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <cerrno>
+#include <csignal>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+using socket_t = int;
+#endif
+
+namespace web {
+
+bool init_platform() {
+#if defined(_WIN32)
+    WSADATA wsa;
+    return WSAStartup(MAKEWORD(2,2), &wsa) == 0;
+#else
+    std::signal(SIGPIPE, SIG_IGN);
+    return true;
+#endif
+}
+
+void cleanup_platform() {
+#if defined(_WIN32)
+    WSACleanup();
+#endif
+}
+
+void close_socket(long long s) {
+#if defined(_WIN32)
+    closesocket(static_cast<socket_t>(s));
+#else
+    close(static_cast<socket_t>(s));
+#endif
+}
+
+bool set_nonblocking(long long s) {
+#if defined(_WIN32)
+    u_long mode = 1;
+    return ioctlsocket(static_cast<socket_t>(s), FIONBIO, &mode) == 0;
+#else
+    int flags = fcntl(static_cast<socket_t>(s), F_GETFL, 0);
+    if (flags < 0) return false;
+    return fcntl(static_cast<socket_t>(s), F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+bool would_block() {
+#if defined(_WIN32)
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+void shutdown_socket(long long s) {
+#if defined(_WIN32)
+    shutdown(static_cast<socket_t>(s), SD_BOTH);
+#else
+    shutdown(static_cast<socket_t>(s), SHUT_RDWR);
+#endif
+}
+
+bool reuse_port_supported() {
+#if defined(SO_REUSEPORT)
+    return true;
+#else
+    return false;
+#endif
+}
+
+void pin_current_thread(unsigned core) {
+#if defined(__linux__)
+    unsigned n = std::thread::hardware_concurrency();
+    if (n == 0) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core % n, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)core;
+#endif
+}
+
+static bool set_timeout(long long s, int opt, std::chrono::milliseconds timeout) {
+#if defined(_WIN32)
+    DWORD ms = static_cast<DWORD>(timeout.count());
+    return setsockopt(static_cast<socket_t>(s), SOL_SOCKET, opt, (const char*)&ms, sizeof(ms)) == 0;
+#else
+    timeval tv{};
+    tv.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+    tv.tv_usec = static_cast<suseconds_t>((timeout.count() % 1000) * 1000);
+    return setsockopt(static_cast<socket_t>(s), SOL_SOCKET, opt, &tv, sizeof(tv)) == 0;
+#endif
+}
+
+bool set_recv_timeout(long long s, std::chrono::milliseconds timeout) {
+    return set_timeout(s, SO_RCVTIMEO, timeout);
+}
+
+bool set_send_timeout(long long s, std::chrono::milliseconds timeout) {
+    return set_timeout(s, SO_SNDTIMEO, timeout);
+}
+
+bool timed_out() {
+#if defined(_WIN32)
+    return WSAGetLastError() == WSAETIMEDOUT;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+bool wait_readable(long long s, std::chrono::milliseconds timeout) {
+#if defined(_WIN32)
+    WSAPOLLFD p{};
+    p.fd = static_cast<socket_t>(s);
+    p.events = POLLRDNORM;
+    return WSAPoll(&p, 1, static_cast<INT>(timeout.count())) > 0;
+#else
+    pollfd p{};
+    p.fd = static_cast<socket_t>(s);
+    p.events = POLLIN;
+    return ::poll(&p, 1, static_cast<int>(timeout.count())) > 0;
+#endif
+}
+
+bool wait_writable(long long s, std::chrono::milliseconds timeout) {
+#if defined(_WIN32)
+    WSAPOLLFD p{};
+    p.fd = static_cast<socket_t>(s);
+    p.events = POLLWRNORM;
+    return WSAPoll(&p, 1, static_cast<INT>(timeout.count())) > 0;
+#else
+    pollfd p{};
+    p.fd = static_cast<socket_t>(s);
+    p.events = POLLOUT;
+    return ::poll(&p, 1, static_cast<int>(timeout.count())) > 0;
+#endif
+}
+
+long long open_listener(const std::string& host, uint16_t port, bool reuse_port) {
+    long long fd =
+#if defined(_WIN32)
+        static_cast<long long>(::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP));
+#else
+        static_cast<long long>(::socket(AF_INET, SOCK_STREAM, 0));
+#endif
+    if (fd < 0) return -1;
+
+    int opt = 1;
+#if defined(_WIN32)
+    setsockopt(static_cast<socket_t>(fd), SOL_SOCKET, SO_REUSEADDR, (const char*)&opt, sizeof(opt));
+#else
+    setsockopt(static_cast<socket_t>(fd), SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+#endif
+#if defined(SO_REUSEPORT)
+    if (reuse_port && setsockopt(static_cast<socket_t>(fd), SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) != 0) {
+        close_socket(fd);
+        return -1;
+    }
+#else
+    if (reuse_port) {
+        close_socket(fd);
+        return -1;
+    }
+#endif
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, host.c_str(), &addr.sin_addr);
+    if (::bind(static_cast<socket_t>(fd), (sockaddr*)&addr, sizeof(addr)) != 0) {
+        close_socket(fd);
+        return -1;
+    }
+    if (::listen(static_cast<socket_t>(fd), SOMAXCONN) != 0) {
+        close_socket(fd);
+        return -1;
+    }
+    return fd;
+}
+
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace web {
+
+bool init_platform();
+void cleanup_platform();
+long long open_listener(const std::string& host, uint16_t port, bool reuse_port = false);
+bool reuse_port_supported();
+void shutdown_socket(long long s);
+void pin_current_thread(unsigned core);
+void close_socket(long long s);
+bool set_nonblocking(long long s);
+bool would_block();
+bool set_recv_timeout(long long s, std::chrono::milliseconds timeout);
+bool set_send_timeout(long long s, std::chrono::milliseconds timeout);
+bool timed_out();
+bool wait_readable(long long s, std::chrono::milliseconds timeout);
+bool wait_writable(long long s, std::chrono::milliseconds timeout);
+
+}
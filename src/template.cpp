@@ -1,52 +1,180 @@
 #include "template.hpp"
-#include <sstream>
+#include "file_util.hpp"
+#include <mutex>
 
 namespace web {
 
-static std::string replace_all(std::string s, const std::string& from, const std::string& to) {
-    size_t pos = 0;
-    while ((pos = s.find(from, pos)) != std::string::npos) {
-        s.replace(pos, from.size(), to);
-        pos += to.size();
+static const std::string kForOpen = "{% for ";
+static const std::string kTagClose = " %}";
+static const std::string kEndFor = "{% endfor %}";
+
+void CompiledTemplate::parse_inline(const std::string& tpl, std::size_t b, std::size_t e, std::vector<Segment>& out) {
+    std::size_t lit = b;
+    std::size_t i = b;
+    while (i < e) {
+        auto open = tpl.find("{{", i);
+        if (open == std::string::npos || open >= e) break;
+        auto close = tpl.find("}}", open + 2);
+        if (close == std::string::npos || close + 2 > e) break;
+        if (open > lit) out.push_back(Segment{Kind::Literal, tpl.substr(lit, open - lit), {}});
+        out.push_back(Segment{Kind::Var, tpl.substr(open + 2, close - open - 2), {}});
+        i = lit = close + 2;
     }
-    return s;
+    if (e > lit) out.push_back(Segment{Kind::Literal, tpl.substr(lit, e - lit), {}});
+}
+
+std::string TemplateEngine::render(const std::string& tpl, const Vars& vars, const Lists& lists) const {
+    return CompiledTemplate::compile(tpl)->render(vars, lists);
 }
 
-static std::string interp(const std::string& s, const Vars& vars) {
-    std::string out = s;
-    for (auto& [k, v] : vars) {
-        out = replace_all(out, "{{" + k + "}}", v);
+std::shared_ptr<const CompiledTemplate> CompiledTemplate::compile(const std::string& tpl) {
+    auto ct = std::make_shared<CompiledTemplate>();
+    std::size_t i = 0;
+    while (i < tpl.size()) {
+        auto open = tpl.find(kForOpen, i);
+        std::size_t name_end = open == std::string::npos ? open : tpl.find(kTagClose, open + kForOpen.size());
+        std::size_t end = name_end == std::string::npos ? name_end : tpl.find(kEndFor, name_end + kTagClose.size());
+        if (end == std::string::npos) break;
+        parse_inline(tpl, i, open, ct->segments_);
+        Segment block{Kind::Block, tpl.substr(open + kForOpen.size(), name_end - open - kForOpen.size()), {}};
+        parse_inline(tpl, name_end + kTagClose.size(), end, block.body);
+        ct->segments_.push_back(std::move(block));
+        i = end + kEndFor.size();
     }
-    return out;
+    parse_inline(tpl, i, tpl.size(), ct->segments_);
+    return ct;
 }
 
-static bool find_block(const std::string& tpl, const std::string& name, size_t& begin, size_t& end) {
-    auto start_tag = std::string("{% for ") + name + " %}";
-    auto end_tag = std::string("{% endfor %}");
-    begin = tpl.find(start_tag);
-    if (begin == std::string::npos) return false;
-    auto body_start = begin + start_tag.size();
-    end = tpl.find(end_tag, body_start);
-    if (end == std::string::npos) return false;
-    return true;
+static const std::string* lookup(const std::string& name, const Vars& vars, const Vars* row) {
+    if (row) {
+        auto it = row->find(name);
+        if (it != row->end()) return &it->second;
+    }
+    auto it = vars.find(name);
+    return it != vars.end() ? &it->second : nullptr;
 }
 
-std::string TemplateEngine::render(const std::string& tpl, const Vars& vars, const Lists& lists) const {
-    std::string out = interp(tpl, vars);
-    for (auto& [list_name, rows] : lists) {
-        size_t b{}, e{};
-        if (find_block(out, list_name, b, e)) {
-            auto start_tag = std::string("{% for ") + list_name + " %}";
-            auto body_start = b + start_tag.size();
-            auto body = out.substr(body_start, e - body_start);
-            std::ostringstream built;
-            for (auto& row : rows) {
-                built << interp(body, row);
+void CompiledTemplate::render_segments(const std::vector<Segment>& segs, const Vars& vars, const Lists* lists, const Vars* row, std::string& out) {
+    for (auto& seg : segs) {
+        switch (seg.kind) {
+            case Kind::Literal:
+                out += seg.text;
+                break;
+            case Kind::Var: {
+                if (auto v = lookup(seg.text, vars, row)) {
+                    out += *v;
+                } else {
+                    out += "{{";
+                    out += seg.text;
+                    out += "}}";
+                }
+                break;
+            }
+            case Kind::Block: {
+                auto it = lists->find(seg.text);
+                if (it == lists->end()) {
+                    out += kForOpen;
+                    out += seg.text;
+                    out += kTagClose;
+                    render_segments(seg.body, vars, nullptr, nullptr, out);
+                    out += kEndFor;
+                    break;
+                }
+                for (auto& r : it->second) {
+                    render_segments(seg.body, vars, nullptr, &r, out);
+                }
+                break;
+            }
+        }
+    }
+}
+
+std::size_t CompiledTemplate::measure(const std::vector<Segment>& segs, const Vars& vars, const Lists* lists, const Vars* row) {
+    std::size_t n = 0;
+    for (auto& seg : segs) {
+        switch (seg.kind) {
+            case Kind::Literal:
+                n += seg.text.size();
+                break;
+            case Kind::Var: {
+                auto v = lookup(seg.text, vars, row);
+                n += v ? v->size() : seg.text.size() + 4;
+                break;
+            }
+            case Kind::Block: {
+                auto it = lists->find(seg.text);
+                if (it == lists->end()) {
+                    n += kForOpen.size() + seg.text.size() + kTagClose.size() + kEndFor.size();
+                    n += measure(seg.body, vars, nullptr, nullptr);
+                    break;
+                }
+                for (auto& r : it->second) n += measure(seg.body, vars, nullptr, &r);
+                break;
             }
-            out = out.substr(0, b) + built.str() + out.substr(e + std::string("{% endfor %}").size());
         }
     }
+    return n;
+}
+
+void CompiledTemplate::render_into(std::string& out, const Vars& vars, const Lists& lists) const {
+    out.reserve(out.size() + measure(segments_, vars, &lists, nullptr));
+    render_segments(segments_, vars, &lists, nullptr, out);
+}
+
+std::string CompiledTemplate::render(const Vars& vars, const Lists& lists) const {
+    std::string out;
+    render_into(out, vars, lists);
     return out;
 }
 
+static std::int64_t steady_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+TemplateCache::TemplateCache(std::chrono::milliseconds check_interval)
+    : interval_ms_(check_interval.count()) {}
+
+void TemplateCache::set_check_interval(std::chrono::milliseconds interval) {
+    interval_ms_ = interval.count();
+}
+
+bool TemplateCache::load(const std::string& path, Entry& e) {
+    std::int64_t mtime = 0;
+    std::uint64_t size = 0;
+    if (!file_stamp(path, mtime, size)) return false;
+    auto content = read_file(path);
+    if (!content) return false;
+    e.tpl.store(CompiledTemplate::compile(*content));
+    e.mtime = mtime;
+    e.size = size;
+    return true;
+}
+
+std::shared_ptr<const CompiledTemplate> TemplateCache::get(const std::string& path) {
+    Entry* e = nullptr;
+    {
+        std::shared_lock<std::shared_mutex> lk(mtx_);
+        auto it = entries_.find(path);
+        if (it != entries_.end()) e = it->second.get();
+    }
+    if (!e) {
+        auto fresh = std::make_unique<Entry>();
+        if (!load(path, *fresh)) return nullptr;
+        fresh->checked_ms = steady_ms();
+        std::unique_lock<std::shared_mutex> lk(mtx_);
+        auto [it, inserted] = entries_.emplace(path, std::move(fresh));
+        return it->second->tpl.load();
+    }
+    auto now = steady_ms();
+    if (now - e->checked_ms.load(std::memory_order_relaxed) >= interval_ms_.load(std::memory_order_relaxed)
+        && !e->checking.exchange(true)) {
+        std::int64_t mtime = 0;
+        std::uint64_t size = 0;
+        if (file_stamp(path, mtime, size) && (mtime != e->mtime || size != e->size)) load(path, *e);
+        e->checked_ms = now;
+        e->checking = false;
+    }
+    return e->tpl.load();
+}
+
 }
@@ -1,4 +1,9 @@
 #pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -13,4 +18,46 @@ public:
     std::string render(const std::string& tpl, const Vars& vars, const Lists& lists = {}) const;
 };
 
+// Immutable parse of a template: literal runs, {{var}} slots and
+// {% for list %}...{% endfor %} blocks. Inside a block, row values take
+// precedence over the outer vars.
+class CompiledTemplate {
+public:
+    static std::shared_ptr<const CompiledTemplate> compile(const std::string& tpl);
+    std::string render(const Vars& vars, const Lists& lists = {}) const;
+    void render_into(std::string& out, const Vars& vars, const Lists& lists = {}) const;
+private:
+    enum class Kind { Literal, Var, Block };
+    struct Segment {
+        Kind kind;
+        std::string text;
+        std::vector<Segment> body;
+    };
+    std::vector<Segment> segments_;
+    static void parse_inline(const std::string& tpl, std::size_t b, std::size_t e, std::vector<Segment>& out);
+    static std::size_t measure(const std::vector<Segment>& segs, const Vars& vars, const Lists* lists, const Vars* row);
+    static void render_segments(const std::vector<Segment>& segs, const Vars& vars, const Lists* lists, const Vars* row, std::string& out);
+};
+
+// Compiled templates per file, re-validated against the file's mtime and
+// size at most once per check interval. Lookups take a shared lock only.
+class TemplateCache {
+public:
+    explicit TemplateCache(std::chrono::milliseconds check_interval = std::chrono::milliseconds(1000));
+    std::shared_ptr<const CompiledTemplate> get(const std::string& path);
+    void set_check_interval(std::chrono::milliseconds interval);
+private:
+    struct Entry {
+        std::atomic<std::shared_ptr<const CompiledTemplate>> tpl;
+        std::atomic<std::int64_t> checked_ms{0};
+        std::atomic<bool> checking{false};
+        std::int64_t mtime = 0;
+        std::uint64_t size = 0;
+    };
+    std::atomic<std::int64_t> interval_ms_;
+    std::shared_mutex mtx_;
+    std::unordered_map<std::string, std::unique_ptr<Entry>> entries_;
+    static bool load(const std::string& path, Entry& e);
+};
+
 }
@@ -0,0 +1,127 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace web {
+
+// Hierarchical timing wheel: kLevels wheels of kSlots buckets, each level
+// kSlots times coarser than the one below. Nodes are intrusive circular list
+// members, so schedule and cancel are O(1) without allocation; advance() only
+// touches the buckets whose time has come and cascades coarse buckets down
+// as the finer wheel wraps. Not thread-safe; meant to be owned by one loop.
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+    struct Node {
+        Node* prev = nullptr;
+        Node* next = nullptr;
+        std::uint64_t due = 0;
+        bool scheduled() const { return next != nullptr; }
+    };
+
+    explicit TimerWheel(std::chrono::milliseconds tick, Clock::time_point origin = Clock::now())
+        : tick_(tick.count() > 0 ? tick : std::chrono::milliseconds(1)), origin_(origin) {
+        for (auto& level : slots_) {
+            for (auto& head : level) head.prev = head.next = &head;
+        }
+    }
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    // (Re)arms n to fire on the first advance() at or after `at`, rounded up
+    // to the tick.
+    void schedule(Node& n, Clock::time_point at) {
+        cancel(n);
+        auto d = at - origin_;
+        std::uint64_t t = d.count() <= 0 ? 0 : static_cast<std::uint64_t>((d + tick_ - Clock::duration(1)) / tick_);
+        n.due = t > now_ ? t : now_ + 1;
+        place(n);
+        ++size_;
+    }
+
+    void cancel(Node& n) {
+        if (!n.scheduled()) return;
+        unlink(n);
+        --size_;
+    }
+
+    // Runs on_expire(Node&) for every node due by `now`. Expired nodes are
+    // unlinked before the callback, which may reschedule or destroy them.
+    template <class F>
+    void advance(Clock::time_point now, F&& on_expire) {
+        auto d = now - origin_;
+        if (d.count() < 0) return;
+        std::uint64_t target = static_cast<std::uint64_t>(d / tick_);
+        while (now_ < target) {
+            if (size_ == 0) {
+                now_ = target;
+                return;
+            }
+            ++now_;
+            for (unsigned l = kLevels - 1; l > 0; --l) {
+                if ((now_ & ((std::uint64_t(1) << (kBits * l)) - 1)) == 0) cascade(l);
+            }
+            Node& head = slots_[0][now_ & kMask];
+            while (head.next != &head) {
+                Node& n = *head.next;
+                unlink(n);
+                --size_;
+                on_expire(n);
+            }
+        }
+    }
+
+    std::size_t size() const { return size_; }
+    std::chrono::milliseconds tick() const { return tick_; }
+
+private:
+    static constexpr unsigned kBits = 6;
+    static constexpr unsigned kSlots = 1u << kBits;
+    static constexpr std::uint64_t kMask = kSlots - 1;
+    static constexpr unsigned kLevels = 4;
+
+    std::chrono::milliseconds tick_;
+    Clock::time_point origin_;
+    std::uint64_t now_ = 0;
+    std::size_t size_ = 0;
+    Node slots_[kLevels][kSlots];
+
+    static void unlink(Node& n) {
+        n.prev->next = n.next;
+        n.next->prev = n.prev;
+        n.prev = n.next = nullptr;
+    }
+
+    void place(Node& n) {
+        std::uint64_t delta = n.due - now_;
+        unsigned l = 0;
+        while (l + 1 < kLevels && delta >= (std::uint64_t(1) << (kBits * (l + 1)))) ++l;
+        std::uint64_t due = n.due;
+        std::uint64_t limit = now_ + (std::uint64_t(1) << (kBits * kLevels)) - 1;
+        if (due > limit) due = limit;
+        Node& head = slots_[l][(due >> (kBits * l)) & kMask];
+        n.prev = head.prev;
+        n.next = &head;
+        head.prev->next = &n;
+        head.prev = &n;
+    }
+
+    void cascade(unsigned level) {
+        Node& head = slots_[level][(now_ >> (kBits * level)) & kMask];
+        Node pending;
+        if (head.next == &head) return;
+        pending.next = head.next;
+        pending.prev = head.prev;
+        pending.next->prev = &pending;
+        pending.prev->next = &pending;
+        head.prev = head.next = &head;
+        while (pending.next != &pending) {
+            Node& n = *pending.next;
+            unlink(n);
+            place(n);
+        }
+    }
+};
+
+}
@@ -0,0 +1,199 @@
+#include "upgrade.hpp"
+#include "logger.hpp"
+#include <cstring>
+#include <utility>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace web {
+
+#if !defined(__linux__)
+
+UpgradeChannel::UpgradeChannel(std::string path, long long listen_fd)
+    : path_(std::move(path)), listen_fd_(listen_fd) {
+    Logger::instance().log(LogLevel::Warn, "Listener handoff is unavailable on this platform");
+}
+
+UpgradeChannel::~UpgradeChannel() = default;
+
+bool UpgradeChannel::ok() const {
+    return false;
+}
+
+bool UpgradeChannel::wait_for_successor(const std::function<bool()>&) {
+    return false;
+}
+
+long long receive_listener(const std::string&, long long& control) {
+    control = -1;
+    return -1;
+}
+
+bool confirm_upgrade(long long) {
+    return false;
+}
+
+#else
+
+namespace {
+
+bool unix_address(const std::string& path, sockaddr_un& addr) {
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) return false;
+    std::memcpy(addr.sun_path, path.c_str(), path.size());
+    return true;
+}
+
+bool readable(int sock) {
+    pollfd p{sock, POLLIN, 0};
+    return ::poll(&p, 1, 200) > 0;
+}
+
+bool send_fd(int sock, int fd) {
+    char byte = 'L';
+    iovec iov{&byte, 1};
+    alignas(cmsghdr) char ctrl[CMSG_SPACE(sizeof(int))]{};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctrl;
+    msg.msg_controllen = sizeof(ctrl);
+    cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_RIGHTS;
+    cm->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(cm), &fd, sizeof(int));
+    ssize_t n;
+    do {
+        n = ::sendmsg(sock, &msg, MSG_NOSIGNAL);
+    } while (n < 0 && errno == EINTR);
+    return n == 1;
+}
+
+int recv_fd(int sock) {
+    char byte = 0;
+    iovec iov{&byte, 1};
+    alignas(cmsghdr) char ctrl[CMSG_SPACE(sizeof(int))]{};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctrl;
+    msg.msg_controllen = sizeof(ctrl);
+    ssize_t n;
+    do {
+        n = ::recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+    } while (n < 0 && errno == EINTR);
+    if (n != 1 || (msg.msg_flags & MSG_CTRUNC)) return -1;
+    cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+    if (!cm || cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SCM_RIGHTS || cm->cmsg_len != CMSG_LEN(sizeof(int))) return -1;
+    int fd = -1;
+    std::memcpy(&fd, CMSG_DATA(cm), sizeof(int));
+    return fd;
+}
+
+}
+
+UpgradeChannel::UpgradeChannel(std::string path, long long listen_fd)
+    : path_(std::move(path)), listen_fd_(listen_fd) {
+    sockaddr_un addr;
+    if (!unix_address(path_, addr)) {
+        Logger::instance().log(LogLevel::Error, "Upgrade socket path is empty or too long: " + path_);
+        return;
+    }
+    int s = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (s < 0) return;
+    // A socket left behind by the previous process (or one that crashed)
+    // is replaced; the predecessor has already sent its listener by now.
+    ::unlink(path_.c_str());
+    if (::bind(s, (sockaddr*)&addr, sizeof(addr)) != 0 || ::chmod(path_.c_str(), 0600) != 0 || ::listen(s, 1) != 0) {
+        Logger::instance().log(LogLevel::Error, "Failed to open upgrade socket " + path_ + ": " + std::strerror(errno));
+        ::close(s);
+        return;
+    }
+    struct stat st{};
+    if (::stat(path_.c_str(), &st) == 0) inode_ = st.st_ino;
+    sock_ = s;
+}
+
+UpgradeChannel::~UpgradeChannel() {
+    if (sock_ < 0) return;
+    ::close(sock_);
+    // A successor may already have bound its own socket at the same path.
+    struct stat st{};
+    if (::stat(path_.c_str(), &st) == 0 && st.st_ino == inode_) ::unlink(path_.c_str());
+}
+
+bool UpgradeChannel::ok() const {
+    return sock_ >= 0;
+}
+
+bool UpgradeChannel::wait_for_successor(const std::function<bool()>& stop) {
+    while (sock_ >= 0 && !stop()) {
+        if (!readable(sock_)) continue;
+        int c = ::accept4(sock_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (c < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            Logger::instance().log(LogLevel::Error, std::string("Upgrade socket accept failed: ") + std::strerror(errno));
+            return false;
+        }
+        Logger::instance().log(LogLevel::Info, "Handing listen socket to a successor process");
+        char ready = 0;
+        ssize_t n = -1;
+        if (send_fd(c, static_cast<int>(listen_fd_))) {
+            // The successor answers after warming up, which may take a while.
+            while (!stop() && !readable(c)) {}
+            do {
+                n = stop() ? -1 : ::recv(c, &ready, 1, 0);
+            } while (n < 0 && errno == EINTR && !stop());
+        }
+        ::close(c);
+        if (n == 1) {
+            Logger::instance().log(LogLevel::Info, "Successor is serving; handing over");
+            return true;
+        }
+        if (stop()) break;
+        Logger::instance().log(LogLevel::Warn, "Successor exited before taking over; still serving");
+    }
+    return false;
+}
+
+long long receive_listener(const std::string& path, long long& control) {
+    control = -1;
+    sockaddr_un addr;
+    if (!unix_address(path, addr)) return -1;
+    int s = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (s < 0) return -1;
+    if (::connect(s, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        Logger::instance().log(LogLevel::Error, "Failed to reach upgrade socket " + path + ": " + std::strerror(errno));
+        ::close(s);
+        return -1;
+    }
+    int fd = recv_fd(s);
+    if (fd < 0) {
+        Logger::instance().log(LogLevel::Error, "No listen socket received from " + path);
+        ::close(s);
+        return -1;
+    }
+    control = s;
+    return fd;
+}
+
+bool confirm_upgrade(long long control) {
+    if (control < 0) return false;
+    char ready = 'R';
+    bool ok = ::send(static_cast<int>(control), &ready, 1, MSG_NOSIGNAL) == 1;
+    ::close(static_cast<int>(control));
+    return ok;
+}
+
+#endif
+
+}
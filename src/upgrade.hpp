@@ -0,0 +1,34 @@
+#pragma once
+#include <functional>
+#include <string>
+
+namespace web {
+
+// Control socket for zero-downtime binary upgrades. The running process
+// listens on a Unix socket at `path`; a replacement connects, receives the
+// listen socket via SCM_RIGHTS and answers with one byte once it is warmed
+// up and accepting. The old process can then stop accepting and drain.
+class UpgradeChannel {
+public:
+    UpgradeChannel(std::string path, long long listen_fd);
+    ~UpgradeChannel();
+    UpgradeChannel(const UpgradeChannel&) = delete;
+    UpgradeChannel& operator=(const UpgradeChannel&) = delete;
+    bool ok() const;
+    // Serves successors until one confirms it has taken over, or returns
+    // false once stop() is true (checked a few times a second). A successor
+    // that disconnects before confirming is logged and the wait goes on.
+    bool wait_for_successor(const std::function<bool()>& stop);
+private:
+    std::string path_;
+    long long listen_fd_;
+    int sock_{-1};
+    unsigned long long inode_{0};
+};
+
+// Successor side: connects to `path` and returns the inherited listen socket,
+// or -1. `control` stays open until confirm_upgrade() reports readiness.
+long long receive_listener(const std::string& path, long long& control);
+bool confirm_upgrade(long long control);
+
+}
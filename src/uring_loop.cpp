@@ -0,0 +1,603 @@
+#include "uring_loop.hpp"
+#include "logger.hpp"
+#include "metrics.hpp"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define WEB_HAVE_IO_URING 1
+#include <arpa/inet.h>
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <string>
+
+namespace web {
+
+#if defined(WEB_HAVE_IO_URING)
+
+static constexpr unsigned kRingEntries = 1024;
+static constexpr unsigned kBufCount = 512;
+static constexpr unsigned kBufSize = 8192;
+static constexpr unsigned kBufGroup = 0;
+static constexpr int kMaxIov = 32;
+static constexpr int kTickMs = 100;
+
+// Low three bits of a connection's user_data name the operation; loop-level
+// operations use small aligned constants that no heap pointer can equal.
+enum : unsigned { kOpRecv = 1, kOpSend = 2, kOpClose = 3, kOpPoll = 4, kOpCancel = 5 };
+static constexpr std::uint64_t kAcceptData = 8;
+static constexpr std::uint64_t kWakeData = 16;
+static constexpr std::uint64_t kTickData = 24;
+static constexpr std::uint64_t kStopAcceptData = 32;
+
+static int sys_setup(unsigned entries, io_uring_params* p) {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, p));
+}
+
+static int sys_enter(int fd, unsigned submit, unsigned wait, unsigned flags) {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, submit, wait, flags, nullptr, 0));
+}
+
+static int sys_register(int fd, unsigned op, void* arg, unsigned nr) {
+    return static_cast<int>(::syscall(__NR_io_uring_register, fd, op, arg, nr));
+}
+
+struct UringLoop::Ring {
+    int fd = -1;
+    unsigned entries = 0;
+    void* sq_map = nullptr;
+    std::size_t sq_map_len = 0;
+    void* cq_map = nullptr;
+    std::size_t cq_map_len = 0;
+    io_uring_sqe* sqes = nullptr;
+    std::size_t sqes_len = 0;
+    unsigned* sq_head = nullptr;
+    unsigned* sq_tail = nullptr;
+    unsigned sq_mask = 0;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned cq_mask = 0;
+    io_uring_cqe* cqes = nullptr;
+    unsigned queued = 0;
+    io_uring_buf* bufs = nullptr;
+    std::size_t bufs_len = 0;
+    char* buf_data = nullptr;
+
+    bool open(unsigned want) {
+        io_uring_params p{};
+        p.flags = IORING_SETUP_COOP_TASKRUN;
+        fd = sys_setup(want, &p);
+        if (fd < 0 && errno == EINVAL) {
+            p = io_uring_params{};
+            fd = sys_setup(want, &p);
+        }
+        if (fd < 0) return false;
+        if (!(p.features & IORING_FEAT_SINGLE_MMAP) || !(p.features & IORING_FEAT_NODROP)) return false;
+        entries = p.sq_entries;
+        sq_map_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        std::size_t cq_len = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        if (cq_len > sq_map_len) sq_map_len = cq_len;
+        sq_map = ::mmap(nullptr, sq_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sq_map == MAP_FAILED) {
+            sq_map = nullptr;
+            return false;
+        }
+        cq_map = sq_map;
+        sqes_len = p.sq_entries * sizeof(io_uring_sqe);
+        void* s = ::mmap(nullptr, sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (s == MAP_FAILED) return false;
+        sqes = static_cast<io_uring_sqe*>(s);
+        auto* base = static_cast<char*>(sq_map);
+        sq_head = reinterpret_cast<unsigned*>(base + p.sq_off.head);
+        sq_tail = reinterpret_cast<unsigned*>(base + p.sq_off.tail);
+        sq_mask = *reinterpret_cast<unsigned*>(base + p.sq_off.ring_mask);
+        auto* array = reinterpret_cast<unsigned*>(base + p.sq_off.array);
+        for (unsigned i = 0; i < p.sq_entries; ++i) array[i] = i;
+        cq_head = reinterpret_cast<unsigned*>(base + p.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(base + p.cq_off.tail);
+        cq_mask = *reinterpret_cast<unsigned*>(base + p.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(base + p.cq_off.cqes);
+        return true;
+    }
+
+    // Registers kBufCount receive buffers as provided buffer group kBufGroup.
+    bool open_buffers(unsigned count, unsigned size) {
+        bufs_len = count * sizeof(io_uring_buf);
+        void* r = ::mmap(nullptr, bufs_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (r == MAP_FAILED) return false;
+        bufs = static_cast<io_uring_buf*>(r);
+        io_uring_buf_reg reg{};
+        reg.ring_addr = reinterpret_cast<std::uint64_t>(bufs);
+        reg.ring_entries = count;
+        reg.bgid = kBufGroup;
+        if (sys_register(fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) return false;
+        if (size == 0) return true;
+        void* d = ::mmap(nullptr, static_cast<std::size_t>(count) * size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (d == MAP_FAILED) return false;
+        buf_data = static_cast<char*>(d);
+        for (unsigned i = 0; i < count; ++i) provide(static_cast<std::uint16_t>(i));
+        return true;
+    }
+
+    // The ring tail overlays the reserved field of the first entry.
+    std::uint16_t& buf_tail() {
+        return bufs[0].resv;
+    }
+
+    void provide(std::uint16_t bid) {
+        std::uint16_t tail = std::atomic_ref<std::uint16_t>(buf_tail()).load(std::memory_order_relaxed);
+        io_uring_buf& b = bufs[tail & (kBufCount - 1)];
+        b.addr = reinterpret_cast<std::uint64_t>(buf_data + static_cast<std::size_t>(bid) * kBufSize);
+        b.len = kBufSize;
+        b.bid = bid;
+        std::atomic_ref<std::uint16_t>(buf_tail()).store(static_cast<std::uint16_t>(tail + 1), std::memory_order_release);
+    }
+
+    const char* buffer(std::uint16_t bid) const {
+        return buf_data + static_cast<std::size_t>(bid) * kBufSize;
+    }
+
+    void submit(unsigned wait) {
+        while (true) {
+            int r = sys_enter(fd, queued, wait, wait > 0 ? IORING_ENTER_GETEVENTS : 0);
+            if (r >= 0) {
+                queued -= (std::min)(queued, static_cast<unsigned>(r));
+                if (queued == 0 || wait == 0) return;
+                continue;
+            }
+            if (errno == EINTR) {
+                if (wait > 0) return;
+                continue;
+            }
+            if (errno == EAGAIN || errno == EBUSY) return;
+            Logger::instance().log(LogLevel::Error, "io_uring_enter failed: " + std::to_string(errno));
+            return;
+        }
+    }
+
+    // Makes room for n consecutive entries so a linked chain is never split
+    // across two submissions.
+    void reserve(unsigned n) {
+        unsigned head = std::atomic_ref<unsigned>(*sq_head).load(std::memory_order_acquire);
+        if (*sq_tail - head + n > entries) submit(0);
+    }
+
+    io_uring_sqe& next(std::uint8_t opcode, int target, std::uint64_t data) {
+        reserve(1);
+        unsigned tail = *sq_tail;
+        io_uring_sqe& e = sqes[tail & sq_mask];
+        std::memset(&e, 0, sizeof(e));
+        e.opcode = opcode;
+        e.fd = target;
+        e.user_data = data;
+        std::atomic_ref<unsigned>(*sq_tail).store(tail + 1, std::memory_order_release);
+        ++queued;
+        return e;
+    }
+
+    ~Ring() {
+        if (buf_data) ::munmap(buf_data, static_cast<std::size_t>(kBufCount) * kBufSize);
+        if (bufs) ::munmap(bufs, bufs_len);
+        if (sqes) ::munmap(sqes, sqes_len);
+        if (sq_map) ::munmap(sq_map, sq_map_len);
+        if (fd >= 0) ::close(fd);
+    }
+};
+
+struct UringLoop::Conn : TimerWheel::Node {
+    int fd = -1;
+    std::uint32_t serial = 0;
+    Session session;
+    TimerWheel::Clock::time_point deadline_at;
+    unsigned inflight = 0;
+    bool recv_armed = false;
+    bool sending = false;
+    bool polling = false;
+    bool closing = false;
+    bool eof = false;
+    iovec iov[kMaxIov];
+    msghdr msg{};
+};
+
+static std::uint64_t conn_data(const void* c, unsigned op) {
+    return reinterpret_cast<std::uint64_t>(c) | op;
+}
+
+bool UringLoop::supported() {
+    static std::once_flag once;
+    static bool ok = false;
+    std::call_once(once, [] {
+        Ring ring;
+        if (!ring.open(8)) return;
+        constexpr unsigned kOps = IORING_OP_LAST;
+        std::vector<char> mem(sizeof(io_uring_probe) + kOps * sizeof(io_uring_probe_op), 0);
+        auto* probe = reinterpret_cast<io_uring_probe*>(mem.data());
+        if (sys_register(ring.fd, IORING_REGISTER_PROBE, probe, kOps) != 0) return;
+        for (unsigned op : {IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_SENDMSG, IORING_OP_CLOSE, IORING_OP_ASYNC_CANCEL, IORING_OP_POLL_ADD, IORING_OP_READ, IORING_OP_TIMEOUT}) {
+            if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) return;
+        }
+        // Buffer rings arrived together with multishot accept (5.19).
+        ok = ring.open_buffers(1, 0);
+    });
+    return ok;
+}
+
+UringLoop::UringLoop(const Router& router, const ServerConfig& cfg, long long listen_fd)
+    : router_(router), cfg_(cfg), listen_fd_(listen_fd), wheel_(std::chrono::milliseconds(kTickMs)) {
+    auto ring = std::make_unique<Ring>();
+    if (!ring->open(kRingEntries) || !ring->open_buffers(kBufCount, kBufSize)) return;
+    wake_fd_ = eventfd(0, EFD_CLOEXEC);
+    if (wake_fd_ < 0) return;
+    ring_ = std::move(ring);
+    mailbox_ = std::make_shared<LoopMailbox>();
+    mailbox_->wake_fd = wake_fd_;
+    post_ = mailbox_post(mailbox_);
+}
+
+UringLoop::~UringLoop() {
+    if (mailbox_) mailbox_take(*mailbox_, true);
+    for (auto& [fd, c] : conns_) {
+        ::close(fd);
+        Metrics::instance().connection_closed();
+    }
+    conns_.clear();
+    ring_.reset();
+    closing_.clear();
+    if (wake_fd_ >= 0) ::close(wake_fd_);
+}
+
+bool UringLoop::ok() const {
+    return ring_ != nullptr;
+}
+
+void UringLoop::stop() {
+    running_ = false;
+    uint64_t one = 1;
+    if (wake_fd_ >= 0) {
+        ssize_t n = ::write(wake_fd_, &one, sizeof(one));
+        (void)n;
+    }
+}
+
+void UringLoop::stop_accepting() {
+    stop_accept_ = true;
+    uint64_t one = 1;
+    if (wake_fd_ >= 0) {
+        ssize_t n = ::write(wake_fd_, &one, sizeof(one));
+        (void)n;
+    }
+}
+
+void UringLoop::expire_idle() {
+    rearm_ = true;
+    uint64_t one = 1;
+    if (wake_fd_ >= 0) {
+        ssize_t n = ::write(wake_fd_, &one, sizeof(one));
+        (void)n;
+    }
+}
+
+void UringLoop::run() {
+    running_ = true;
+    arm_accept();
+    arm_wake();
+    arm_tick();
+    Ring& r = *ring_;
+    while (running_) {
+        r.submit(1);
+        unsigned head = *r.cq_head;
+        unsigned tail = std::atomic_ref<unsigned>(*r.cq_tail).load(std::memory_order_acquire);
+        while (head != tail) {
+            io_uring_cqe cqe = r.cqes[head & r.cq_mask];
+            ++head;
+            std::atomic_ref<unsigned>(*r.cq_head).store(head, std::memory_order_release);
+            if (cqe.user_data == kAcceptData) {
+                if (cqe.res >= 0) on_accept(cqe.res);
+                else if (cqe.res != -EAGAIN && cqe.res != -EINTR && cqe.res != -ECONNABORTED && cqe.res != -ECANCELED) {
+                    Logger::instance().log(LogLevel::Warn, "io_uring accept failed: " + std::to_string(-cqe.res));
+                }
+                if (!(cqe.flags & IORING_CQE_F_MORE)) {
+                    accepting_ = false;
+                    if (cqe.res != -EINVAL && cqe.res != -EBADF) arm_accept();
+                }
+                continue;
+            }
+            if (cqe.user_data == kWakeData) {
+                if (stop_accept_ && accepting_) {
+                    auto& e = ring_->next(IORING_OP_ASYNC_CANCEL, -1, kStopAcceptData);
+                    e.addr = kAcceptData;
+                }
+                if (rearm_.exchange(false)) {
+                    for (auto& [fd, c] : conns_) arm(*c);
+                }
+                run_completions();
+                if (running_) arm_wake();
+                continue;
+            }
+            if (cqe.user_data == kStopAcceptData) continue;
+            if (cqe.user_data == kTickData) {
+                auto now = TimerWheel::Clock::now();
+                wheel_.advance(now, [this, now](TimerWheel::Node& node) {
+                    on_deadline(static_cast<Conn&>(node), now);
+                });
+                if (running_) arm_tick();
+                continue;
+            }
+            auto* c = reinterpret_cast<Conn*>(cqe.user_data & ~std::uint64_t(7));
+            on_conn_event(*c, static_cast<unsigned>(cqe.user_data & 7), cqe.res, cqe.flags);
+        }
+        if (!starved_.empty()) {
+            auto starved = std::move(starved_);
+            starved_.clear();
+            for (auto [fd, serial] : starved) {
+                auto it = conns_.find(fd);
+                if (it != conns_.end() && it->second->serial == serial) settle(*it->second);
+            }
+        }
+    }
+}
+
+void UringLoop::arm_accept() {
+    if (accepting_ || !running_ || stop_accept_) return;
+    auto& e = ring_->next(IORING_OP_ACCEPT, static_cast<int>(listen_fd_), kAcceptData);
+    e.ioprio = IORING_ACCEPT_MULTISHOT;
+    e.accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    accepting_ = true;
+}
+
+void UringLoop::arm_wake() {
+    auto& e = ring_->next(IORING_OP_READ, wake_fd_, kWakeData);
+    e.addr = reinterpret_cast<std::uint64_t>(&wake_buf_);
+    e.len = sizeof(wake_buf_);
+    e.off = static_cast<std::uint64_t>(-1);
+}
+
+void UringLoop::arm_tick() {
+    static const __kernel_timespec tick{0, kTickMs * 1000000LL};
+    auto& e = ring_->next(IORING_OP_TIMEOUT, -1, kTickData);
+    e.addr = reinterpret_cast<std::uint64_t>(&tick);
+    e.len = 1;
+}
+
+void UringLoop::arm_recv(Conn& c) {
+    auto& e = ring_->next(IORING_OP_RECV, c.fd, conn_data(&c, kOpRecv));
+    e.len = kBufSize;
+    e.flags = IOSQE_BUFFER_SELECT;
+    e.buf_group = kBufGroup;
+    c.recv_armed = true;
+    ++c.inflight;
+}
+
+void UringLoop::on_accept(int fd) {
+    sockaddr_in addr{};
+    socklen_t len = sizeof(addr);
+    char ipbuf[INET_ADDRSTRLEN]{};
+    if (::getpeername(fd, (sockaddr*)&addr, &len) == 0) inet_ntop(AF_INET, &addr.sin_addr, ipbuf, sizeof(ipbuf));
+    auto conn = std::make_unique<Conn>();
+    Conn& c = *conn;
+    c.fd = fd;
+    c.serial = ++next_serial_;
+    c.session.tag = (static_cast<std::uint64_t>(c.serial) << 32) | static_cast<std::uint32_t>(fd);
+    c.session.remote = std::string(ipbuf) + ":" + std::to_string(ntohs(addr.sin_port));
+    conns_[fd] = std::move(conn);
+    Metrics::instance().connection_opened();
+    settle(c);
+}
+
+void UringLoop::on_conn_event(Conn& c, unsigned op, int res, unsigned flags) {
+    --c.inflight;
+    switch (op) {
+        case kOpRecv:
+            c.recv_armed = false;
+            on_recv(c, res, flags);
+            break;
+        case kOpSend:
+            c.sending = false;
+            if (res >= 0) consume_output(c.session, static_cast<std::size_t>(res));
+            if (c.closing || res < 0) {
+                if (!c.closing) close_now(c);
+                break;
+            }
+            settle(c);
+            break;
+        case kOpPoll:
+            c.polling = false;
+            if (!c.closing) settle(c);
+            break;
+        case kOpClose:
+            if (res == -ECANCELED) ::close(c.fd);
+            break;
+        default:
+            break;
+    }
+    if (c.closing) release(c);
+}
+
+void UringLoop::on_recv(Conn& c, int res, unsigned flags) {
+    if (flags & IORING_CQE_F_BUFFER) {
+        auto bid = static_cast<std::uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+        if (res > 0 && !c.closing) append_input(c.session, ring_->buffer(bid), static_cast<std::size_t>(res));
+        ring_->provide(bid);
+    }
+    if (c.closing) return;
+    if (res == -ENOBUFS) {
+        starved_.emplace_back(c.fd, c.serial);
+        return;
+    }
+    if (res < 0 && res != -EAGAIN && res != -EINTR) {
+        close_now(c);
+        return;
+    }
+    if (res > 0) {
+        process_input(c.session, router_, cfg_, &post_);
+    } else if (res == 0) {
+        c.eof = true;
+        reject_incomplete(c.session);
+    }
+    settle(c);
+}
+
+void UringLoop::run_completions() {
+    for (auto& call : mailbox_take(*mailbox_)) {
+        auto it = conns_.find(static_cast<int>(call->tag & 0xffffffffu));
+        if (it == conns_.end() || it->second->serial != static_cast<std::uint32_t>(call->tag >> 32)) continue;
+        Conn& c = *it->second;
+        complete_async(c.session, *call, router_, cfg_, &post_);
+        settle(c);
+    }
+}
+
+void UringLoop::settle(Conn& c) {
+    if (!c.sending && !c.polling) send(c);
+    if (c.closing) return;
+    if (!c.recv_armed && !c.eof && !c.session.close_after_write && !input_full(c.session, cfg_)) arm_recv(c);
+    arm(c);
+}
+
+void UringLoop::send(Conn& c) {
+    IoSlice slices[kMaxIov];
+    bool complete = false;
+    int n = gather_output(c.session, slices, kMaxIov, complete);
+    if (n == 0) {
+        if (output_pending(c.session) && flush_output(c.session, c.fd) == IoStatus::WouldBlock) {
+            auto& e = ring_->next(IORING_OP_POLL_ADD, c.fd, conn_data(&c, kOpPoll));
+            e.poll32_events = POLLOUT;
+            c.polling = true;
+            ++c.inflight;
+            return;
+        }
+        if (c.session.close_after_write && !c.session.awaiting) close_now(c);
+        return;
+    }
+    for (int i = 0; i < n; ++i) {
+        c.iov[i].iov_base = const_cast<char*>(slices[i].data);
+        c.iov[i].iov_len = slices[i].len;
+    }
+    c.msg = msghdr{};
+    c.msg.msg_iov = c.iov;
+    c.msg.msg_iovlen = static_cast<std::size_t>(n);
+    bool last = complete && c.session.close_after_write && !c.session.awaiting;
+    if (last) {
+        retire(c);
+        ring_->reserve(2);
+    }
+    auto& e = ring_->next(IORING_OP_SENDMSG, c.fd, conn_data(&c, kOpSend));
+    e.addr = reinterpret_cast<std::uint64_t>(&c.msg);
+    e.len = 1;
+    e.msg_flags = MSG_NOSIGNAL;
+    c.sending = true;
+    ++c.inflight;
+    if (last) {
+        // MSG_WAITALL makes a short send fail the link, so the close is then
+        // cancelled and done by hand.
+        e.msg_flags |= MSG_WAITALL;
+        e.flags |= IOSQE_IO_LINK;
+        ring_->next(IORING_OP_CLOSE, c.fd, conn_data(&c, kOpClose));
+        ++c.inflight;
+    }
+}
+
+void UringLoop::arm(Conn& c) {
+    TimerWheel::Clock::time_point at;
+    if (next_deadline(c.session, cfg_, at) == Deadline::None) {
+        wheel_.cancel(c);
+        return;
+    }
+    if (c.scheduled() && c.deadline_at <= at) return;
+    c.deadline_at = at;
+    wheel_.schedule(c, at);
+}
+
+void UringLoop::on_deadline(Conn& c, TimerWheel::Clock::time_point now) {
+    TimerWheel::Clock::time_point at;
+    auto kind = next_deadline(c.session, cfg_, at);
+    if (kind == Deadline::None) return;
+    if (at > now) {
+        c.deadline_at = at;
+        wheel_.schedule(c, at);
+        return;
+    }
+    expire_deadline(c.session, kind);
+    if (kind == Deadline::Write) {
+        close_now(c);
+        return;
+    }
+    settle(c);
+}
+
+// Stops tracking c as a live connection; it stays allocated until every
+// operation still referring to it has completed.
+void UringLoop::retire(Conn& c) {
+    c.closing = true;
+    wheel_.cancel(c);
+    auto it = conns_.find(c.fd);
+    if (it != conns_.end() && it->second.get() == &c) {
+        closing_.emplace(&c, std::move(it->second));
+        conns_.erase(it);
+    }
+    Metrics::instance().connection_closed();
+    if (c.recv_armed) {
+        auto& e = ring_->next(IORING_OP_ASYNC_CANCEL, -1, conn_data(&c, kOpCancel));
+        e.addr = conn_data(&c, kOpRecv);
+        ++c.inflight;
+    }
+}
+
+void UringLoop::close_now(Conn& c) {
+    if (c.closing) return;
+    retire(c);
+    for (unsigned op : {kOpSend, kOpPoll}) {
+        if ((op == kOpSend && !c.sending) || (op == kOpPoll && !c.polling)) continue;
+        auto& e = ring_->next(IORING_OP_ASYNC_CANCEL, -1, conn_data(&c, kOpCancel));
+        e.addr = conn_data(&c, op);
+        ++c.inflight;
+    }
+    ring_->next(IORING_OP_CLOSE, c.fd, conn_data(&c, kOpClose));
+    ++c.inflight;
+}
+
+void UringLoop::release(Conn& c) {
+    if (c.inflight == 0) closing_.erase(&c);
+}
+
+#else
+
+struct UringLoop::Ring {};
+struct UringLoop::Conn : TimerWheel::Node {};
+
+UringLoop::UringLoop(const Router& router, const ServerConfig& cfg, long long listen_fd)
+    : router_(router), cfg_(cfg), listen_fd_(listen_fd), wheel_(std::chrono::milliseconds(1)) {}
+
+UringLoop::~UringLoop() = default;
+
+bool UringLoop::supported() {
+    return false;
+}
+
+bool UringLoop::ok() const {
+    return false;
+}
+
+void UringLoop::run() {}
+
+void UringLoop::stop() {}
+
+void UringLoop::stop_accepting() {}
+
+void UringLoop::expire_idle() {}
+
+#endif
+
+}
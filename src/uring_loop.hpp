@@ -0,0 +1,73 @@
+#pragma once
+#include "event_loop.hpp"
+#include "router.hpp"
+#include "session.hpp"
+#include "server_config.hpp"
+#include "timer_wheel.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace web {
+
+// io_uring reactor driven through raw syscalls, one ring per loop thread.
+// A multishot accept feeds connections, receives take buffers from a
+// provided buffer ring, responses go out as one vectored send, and the last
+// response of a closing connection is linked to its close. supported()
+// reports false on kernels without buffer rings or multishot accept.
+class UringLoop {
+public:
+    UringLoop(const Router& router, const ServerConfig& cfg, long long listen_fd);
+    ~UringLoop();
+    UringLoop(const UringLoop&) = delete;
+    UringLoop& operator=(const UringLoop&) = delete;
+    bool ok() const;
+    void run();
+    void stop();
+    // Cancels the multishot accept; connections already accepted keep going.
+    void stop_accepting();
+    // Re-arms every connection's deadline on the loop thread, so idle
+    // keep-alive connections close promptly once a drain has begun.
+    void expire_idle();
+    static bool supported();
+private:
+    struct Ring;
+    struct Conn;
+    const Router& router_;
+    const ServerConfig& cfg_;
+    long long listen_fd_;
+    int wake_fd_{-1};
+    std::uint64_t wake_buf_{0};
+    std::atomic<bool> running_{false};
+    std::atomic<bool> stop_accept_{false};
+    std::atomic<bool> rearm_{false};
+    bool accepting_{false};
+    std::unique_ptr<Ring> ring_;
+    std::unordered_map<int, std::unique_ptr<Conn>> conns_;
+    std::unordered_map<Conn*, std::unique_ptr<Conn>> closing_;
+    std::vector<std::pair<int, std::uint32_t>> starved_;
+    std::uint32_t next_serial_{0};
+    TimerWheel wheel_;
+    std::shared_ptr<LoopMailbox> mailbox_;
+    AsyncPost post_;
+    void arm_accept();
+    void arm_wake();
+    void arm_tick();
+    void arm_recv(Conn& c);
+    void on_accept(int fd);
+    void on_recv(Conn& c, int res, unsigned flags);
+    void on_conn_event(Conn& c, unsigned op, int res, unsigned flags);
+    void run_completions();
+    void settle(Conn& c);
+    void send(Conn& c);
+    void arm(Conn& c);
+    void on_deadline(Conn& c, TimerWheel::Clock::time_point now);
+    void retire(Conn& c);
+    void close_now(Conn& c);
+    void release(Conn& c);
+};
+
+}
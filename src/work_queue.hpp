@@ -0,0 +1,197 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace web {
+
+// Bounded lock-free MPMC ring (sequence-numbered slots). Capacity is rounded
+// up to a power of two. try_push fails when full, try_pop when empty.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(std::size_t capacity) {
+        std::size_t cap = 2;
+        while (cap < capacity) cap <<= 1;
+        slots_ = std::make_unique<Slot[]>(cap);
+        for (std::size_t i = 0; i < cap; ++i) slots_[i].seq.store(i, std::memory_order_relaxed);
+        mask_ = cap - 1;
+    }
+
+    bool try_push(T&& v) {
+        std::size_t pos = tail_.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& s = slots_[pos & mask_];
+            std::size_t seq = s.seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    s.value = std::move(v);
+                    s.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool try_pop(T& out) {
+        std::size_t pos = head_.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& s = slots_[pos & mask_];
+            std::size_t seq = s.seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    out = std::move(s.value);
+                    s.seq.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::size_t size() const {
+        std::size_t t = tail_.load(std::memory_order_relaxed);
+        std::size_t h = head_.load(std::memory_order_relaxed);
+        return t > h ? t - h : 0;
+    }
+
+    std::size_t capacity() const { return mask_ + 1; }
+
+private:
+    struct Slot {
+        std::atomic<std::size_t> seq{0};
+        T value{};
+    };
+    std::unique_ptr<Slot[]> slots_;
+    std::size_t mask_ = 0;
+    alignas(64) std::atomic<std::size_t> tail_{0};
+    alignas(64) std::atomic<std::size_t> head_{0};
+};
+
+// One bounded queue per worker. Producers spread items round-robin; a worker
+// drains its own queue first and then steals from the others starting at a
+// random victim. Idle workers park on their own futex word, and a producer
+// wakes exactly one parked worker: the owner of the queue it pushed to, or
+// any other parked worker that can steal the item.
+template <typename T>
+class StealingQueues {
+public:
+    StealingQueues(unsigned workers, std::size_t capacity) : limit_(capacity == 0 ? 1 : capacity) {
+        if (workers == 0) workers = 1;
+        std::size_t per = (capacity + workers - 1) / workers;
+        for (unsigned i = 0; i < workers; ++i) workers_.push_back(std::make_unique<Worker>(per == 0 ? 1 : per));
+    }
+
+    bool push(T&& v) {
+        if (count_.fetch_add(1) >= limit_) {
+            count_.fetch_sub(1);
+            return false;
+        }
+        unsigned n = static_cast<unsigned>(workers_.size());
+        unsigned start = next_.fetch_add(1, std::memory_order_relaxed) % n;
+        for (unsigned k = 0; k < n; ++k) {
+            unsigned i = (start + k) % n;
+            if (workers_[i]->q.try_push(std::move(v))) {
+                notify(i);
+                return true;
+            }
+        }
+        count_.fetch_sub(1);
+        return false;
+    }
+
+    bool pop(unsigned worker, T& out) {
+        unsigned n = static_cast<unsigned>(workers_.size());
+        if (workers_[worker % n]->q.try_pop(out)) {
+            count_.fetch_sub(1);
+            return true;
+        }
+        thread_local std::uint32_t rng = static_cast<std::uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id())) | 1u;
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        unsigned start = rng % n;
+        for (unsigned k = 0; k < n; ++k) {
+            unsigned i = (start + k) % n;
+            if (i != worker % n && workers_[i]->q.try_pop(out)) {
+                count_.fetch_sub(1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool pop_oldest(T& out) {
+        unsigned n = static_cast<unsigned>(workers_.size());
+        unsigned start = next_.load(std::memory_order_relaxed) % n;
+        for (unsigned k = 0; k < n; ++k) {
+            if (workers_[(start + k) % n]->q.try_pop(out)) {
+                count_.fetch_sub(1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void park(unsigned worker, const std::atomic<bool>& running) {
+        Worker& w = *workers_[worker % workers_.size()];
+        auto seen = w.signal.load(std::memory_order_acquire);
+        w.parked.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (running.load(std::memory_order_relaxed) && size() == 0) w.signal.wait(seen, std::memory_order_acquire);
+        w.parked.store(false, std::memory_order_relaxed);
+    }
+
+    void wake_all() {
+        for (auto& w : workers_) {
+            w->signal.fetch_add(1, std::memory_order_release);
+            w->signal.notify_all();
+        }
+    }
+
+    std::size_t size() const { return count_.load(); }
+
+    std::size_t capacity() const { return limit_; }
+
+private:
+    struct alignas(64) Worker {
+        explicit Worker(std::size_t capacity) : q(capacity) {}
+        BoundedQueue<T> q;
+        alignas(64) std::atomic<std::uint32_t> signal{0};
+        std::atomic<bool> parked{false};
+    };
+
+    void notify(unsigned target) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        unsigned n = static_cast<unsigned>(workers_.size());
+        for (unsigned k = 0; k < n; ++k) {
+            Worker& w = *workers_[(target + k) % n];
+            if (w.parked.load(std::memory_order_relaxed) && w.parked.exchange(false, std::memory_order_relaxed)) {
+                w.signal.fetch_add(1, std::memory_order_release);
+                w.signal.notify_one();
+                return;
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::size_t limit_;
+    alignas(64) std::atomic<std::size_t> count_{0};
+    alignas(64) std::atomic<unsigned> next_{0};
+};
+
+}
@@ -0,0 +1,50 @@
+#include "ccss.hpp"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+// Compiled stylesheets must follow edits to the entry file and to its
+// imports while the cache keeps being hit, not only after it goes idle.
+
+namespace fs = std::filesystem;
+
+static void write(const fs::path& p, const std::string& s) {
+    std::ofstream(p, std::ios::binary | std::ios::trunc) << s;
+}
+
+static constexpr auto kInterval = std::chrono::milliseconds(50);
+
+// Hits the cache every 5 ms until the output contains `want`.
+static bool picked_up(web::CcssCache& cache, const char* what, const std::string& want) {
+    auto start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start < kInterval * 40) {
+        auto css = cache.get("main.ccss");
+        if (css && css->find(want) != std::string::npos) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    std::fprintf(stderr, "%s: compiled CSS never showed \"%s\" under steady hits\n", what, want.c_str());
+    return false;
+}
+
+int main() {
+    fs::path dir = fs::temp_directory_path() / ("web_ccss_cache_test_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+    fs::create_directories(dir);
+    write(dir / "vars.ccss", "$fg: red;\n");
+    write(dir / "main.ccss", "@import \"vars.ccss\";\nbody {\n  color: $fg;\n}\n");
+
+    web::CcssCache cache(dir.string(), 8, kInterval);
+    bool ok = picked_up(cache, "initial compile", "color: red");
+    if (ok) {
+        write(dir / "vars.ccss", "$fg: darkblue;\n");
+        ok = picked_up(cache, "edited import", "color: darkblue");
+    }
+    if (ok) {
+        write(dir / "main.ccss", "@import \"vars.ccss\";\nbody {\n  color: $fg;\n  margin: 0;\n}\n");
+        ok = picked_up(cache, "edited entry", "margin: 0");
+    }
+    fs::remove_all(dir);
+    return ok ? 0 : 1;
+}
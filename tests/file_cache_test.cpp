@@ -0,0 +1,53 @@
+#include "file_cache.hpp"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+// A file served on every request must still be re-validated once per
+// interval: hits inside the window may not push the next stat() out.
+
+namespace fs = std::filesystem;
+
+static void write(const fs::path& p, const std::string& s) {
+    std::ofstream(p, std::ios::binary | std::ios::trunc) << s;
+}
+
+int main() {
+    fs::path dir = fs::temp_directory_path() / ("web_file_cache_test_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+    fs::create_directories(dir);
+    fs::path file = dir / "page.html";
+    write(file, "hello");
+
+    constexpr auto interval = std::chrono::milliseconds(50);
+    web::FileCache cache(16, interval);
+    auto first = cache.open(file.string());
+    if (!first || first->size != 5) {
+        std::fprintf(stderr, "initial open failed\n");
+        return 1;
+    }
+
+    // Rewrite in place (same inode) while hits keep arriving every 5 ms.
+    write(file, "hello, rewritten!!!");
+    auto start = std::chrono::steady_clock::now();
+    bool seen = false;
+    while (std::chrono::steady_clock::now() - start < interval * 40) {
+        auto f = cache.open(file.string());
+        if (f && f->size == 19) {
+            seen = true;
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    fs::remove_all(dir);
+    if (!seen) {
+        std::fprintf(stderr, "rewritten file still cached with its old size after %lld ms of steady hits\n",
+            static_cast<long long>((interval * 40).count()));
+        return 1;
+    }
+    std::printf("rewrite picked up after %lld ms\n", static_cast<long long>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count()));
+    return 0;
+}
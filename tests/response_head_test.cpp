@@ -0,0 +1,56 @@
+#include "http.hpp"
+#include <cctype>
+#include <cstdio>
+#include <string>
+
+// The head and the body of a response must be framed by the same rule,
+// whatever case a handler used for its Content-Length header.
+
+static std::size_t count(const std::string& s, const std::string& what) {
+    std::size_t n = 0;
+    for (auto p = s.find(what); p != std::string::npos; p = s.find(what, p + 1)) ++n;
+    return n;
+}
+
+static bool expect(bool ok, const char* what, const std::string& wire) {
+    if (!ok) std::fprintf(stderr, "%s\n--- response ---\n%s\n", what, wire.c_str());
+    return ok;
+}
+
+int main() {
+    bool ok = true;
+
+    web::Response stream;
+    stream.headers["content-length"] = "5";
+    stream.stream = [sent = false](std::string& out) mutable {
+        if (!sent) out += "hello";
+        sent = true;
+        return false;
+    };
+    std::string wire = stream.to_string();
+    ok &= expect(!stream.streams_chunked(), "stream with content-length is treated as chunked", wire);
+    ok &= expect(stream.content_length() == 5, "content_length() ignores lower-case content-length", wire);
+    ok &= expect(count(wire, "Transfer-Encoding") == 0, "head announces chunked framing for a sized stream", wire);
+    ok &= expect(wire.size() >= 9 && wire.compare(wire.size() - 9, 9, "\r\n\r\nhello") == 0, "sized stream body is not written raw", wire);
+
+    web::Response chunked;
+    chunked.stream = [](std::string& out) {
+        out += "hi";
+        return false;
+    };
+    wire = chunked.to_string();
+    ok &= expect(count(wire, "Transfer-Encoding: chunked\r\n") == 1, "unsized stream is not chunked", wire);
+    ok &= expect(wire.find("\r\n\r\n2\r\nhi\r\n0\r\n\r\n") != std::string::npos, "unsized stream body is not chunk-framed", wire);
+
+    web::Response fixed;
+    fixed.body = "abc";
+    fixed.headers["CONTENT-LENGTH"] = "3";
+    fixed.headers["date"] = "Thu, 01 Jan 2026 00:00:00 GMT";
+    wire = fixed.to_string();
+    std::string lower = wire;
+    for (auto& c : lower) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    ok &= expect(count(lower, "content-length:") == 1, "Content-Length emitted twice", wire);
+    ok &= expect(count(lower, "\r\ndate:") == 1, "Date emitted twice", wire);
+
+    return ok ? 0 : 1;
+}